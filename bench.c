@@ -0,0 +1,1467 @@
+/* Benchmark harness for the merge sort engines.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+// Sweeps engines x array sizes x input distributions x process
+// counts, and reports the minimum, median and 95th percentile of
+// the sort time over the measured repetitions, with the speedup and
+// parallel efficiency relative to the serial engine.
+//
+// The serial and OpenMP engines run in-process (see msort.h), on
+// each input distribution of sort_input.h.  The MPI and UPC
+// engines are run as programs, through the MPI launcher or with
+// the UPC "-n" option, and their "Elapsed = " line is parsed; they
+// generate their own (random) input, so they are measured for the
+// "random" distribution only.
+//
+// Results are written to PREFIX.csv and PREFIX.json; the JSON file
+// also holds every sample, for later comparison between runs.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <omp.h>
+#include "msort.h"
+#include "sort_input.h"
+#include "sort_tune.h"
+#include "sort_validate.h"
+#include "bench.h"
+
+#define MAX_LIST 64
+
+extern double get_time (void);
+
+static void
+sort_serial (int a[], int size, int temp[], int threads)
+{
+  mergesort_serial (a, size, temp);
+}
+
+static void
+sort_natural (int a[], int size, int temp[], int threads)
+{
+  natural_mergesort (a, size, temp);
+}
+
+static void
+sort_lsd_radix8 (int a[], int size, int temp[], int threads)
+{
+  radix_lsd_omp (a, size, temp, threads, 8);
+}
+
+static void
+sort_lsd_radix11 (int a[], int size, int temp[], int threads)
+{
+  radix_lsd_omp (a, size, temp, threads, 11);
+}
+
+// Report the engine that the dispatcher picks, when it changes.
+static void
+sort_dispatch (int a[], int size, int temp[], int threads)
+{
+  static enum sort_engine last = SORT_ENGINE_N;
+  struct sort_choice c;
+  sort_dispatch_omp (a, size, temp, threads, &c);
+  if (c.engine != last)
+    printf ("omp_dispatch: %s for %d keys (%s)\n",
+	    sort_engine_name[c.engine], size, c.reason);
+  last = c.engine;
+}
+
+// The segments of omp_segmented, kept between runs: a mix of single
+// keys, small_sort's sizes and sizes up to SEG_MAX
+#define SEG_MAX 10000
+static int *seg_offsets;
+static int seg_size = -1, seg_n;
+
+static void
+segments_init (int size)
+{
+  unsigned int h = 12345;
+  int n = 0;
+  long off = 0;
+  if (size == seg_size)
+    return;
+  free (seg_offsets);
+  // At most one segment per key, and the final offset
+  seg_offsets = malloc (sizeof (int) * (size + 2));
+  if (seg_offsets == NULL)
+    {
+      printf ("Error: Could not allocate array of size %d\n", size + 2);
+      exit (1);
+    }
+  while (off < size)
+    {
+      int len;
+      seg_offsets[n++] = off;
+      h = h * 1103515245 + 12345;
+      switch ((h >> 16) % 3)
+	{
+	case 0:
+	  len = 1;
+	  break;
+	case 1:
+	  len = 2 + (h >> 8) % (SMALL_SORT_MAX - 1);
+	  break;
+	default:
+	  len = SMALL_SORT_MAX + 1 + (h >> 4) % (SEG_MAX - SMALL_SORT_MAX);
+	  break;
+	}
+      off += len < size - off ? len : size - off;
+    }
+  seg_offsets[n] = size;
+  seg_n = n;
+  seg_size = size;
+}
+
+static void
+sort_segmented (int a[], int size, int temp[], int threads)
+{
+  segments_init (size);
+  segmented_sort_omp (a, seg_offsets, seg_n, temp, threads);
+}
+
+// Each segment is sorted, and all hold the keys of IN.
+static int
+check_segmented (const int a[], int size, int dist,
+		 const struct sort_sum *in)
+{
+  struct sort_check c = SORT_CHECK_INIT;
+  int i;
+  for (i = 0; i < seg_n; i++)
+    sort_check_add (&c, a + seg_offsets[i],
+		    seg_offsets[i + 1] - seg_offsets[i], seg_offsets[i], 0);
+  return sort_check_report (&c, in);
+}
+
+// The group offsets of omp_group, kept between runs
+static int *group_offsets;
+static int group_size = -1;
+
+// sort_group_offsets leaves A sorted, so is checked as a sort.
+static void
+sort_group (int a[], int size, int temp[], int threads)
+{
+  if (size > group_size)
+    {
+      free (group_offsets);
+      group_offsets = malloc (sizeof (int) * (size + 1));
+      if (group_offsets == NULL)
+	{
+	  printf ("Error: Could not allocate array of size %d\n", size + 1);
+	  exit (1);
+	}
+      group_size = size;
+    }
+  sort_group_offsets (a, size, temp, group_offsets, threads);
+}
+
+// The index arrays of the argsort engines, kept between runs
+static int *arg_idx, *arg_idx_temp;
+static int arg_size;
+
+static void
+sort_argsort (int a[], int size, int temp[], int threads)
+{
+  if (size > arg_size)
+    {
+      free (arg_idx);
+      free (arg_idx_temp);
+      arg_idx = malloc (sizeof (int) * size);
+      arg_idx_temp = malloc (sizeof (int) * size);
+      if (arg_idx == NULL || arg_idx_temp == NULL)
+	{
+	  printf ("Error: Could not allocate array of size %d\n", size);
+	  exit (1);
+	}
+      arg_size = size;
+    }
+  if (threads == 1)
+    argsort_serial (a, arg_idx, size, temp, arg_idx_temp);
+  else
+    argsort_omp (a, arg_idx, size, temp, arg_idx_temp, threads);
+}
+
+// A key of the input, with its index, for the generic path of
+// apply_permutation_omp
+struct arg_elem
+{
+  int key, idx, pad;
+};
+
+// A[i] is INPUT[arg_idx[i]], and arg_idx ascends within each run of
+// equal keys; apply_permutation_omp by arg_idx gives A again, for
+// ints and for ELEMs.
+static int
+check_permutation (const int a[], int size, const int input[], char seen[],
+		   int out[], struct arg_elem elem[],
+		   struct arg_elem elem_out[])
+{
+  int threads = omp_get_max_threads (), i;
+  for (i = 0; i < size; i++)
+    {
+      int j = arg_idx[i];
+      if (j < 0 || j >= size || seen[j])
+	{
+	  printf ("Implementation error: idx[%d] = %d is not a permutation\n",
+		  i, j);
+	  return 0;
+	}
+      seen[j] = 1;
+      if (input[j] != a[i])
+	{
+	  printf ("Implementation error: a[%d] = %d, not input[%d] = %d\n",
+		  i, a[i], j, input[j]);
+	  return 0;
+	}
+      if (i > 0 && a[i - 1] == a[i] && arg_idx[i - 1] > j)
+	{
+	  printf ("Implementation error: idx[%d] > idx[%d] for equal keys"
+		  " (not stable)\n", i - 1, i);
+	  return 0;
+	}
+      elem[j].key = input[j];
+      elem[j].idx = j;
+      elem[j].pad = 0;
+    }
+  apply_permutation_omp (arg_idx, size, input, out, sizeof (int), threads);
+  apply_permutation_omp (arg_idx, size, elem, elem_out, sizeof (*elem),
+			 threads);
+  for (i = 0; i < size; i++)
+    if (out[i] != a[i] || elem_out[i].key != a[i]
+	|| elem_out[i].idx != arg_idx[i])
+      {
+	printf ("Implementation error: apply_permutation_omp: element %d\n",
+		i);
+	return 0;
+      }
+  return 1;
+}
+
+// A is sorted, and arg_idx the stable permutation that sorts input
+// DIST.
+static int
+check_argsort (const int a[], int size, int dist, const struct sort_sum *in)
+{
+  int *input = malloc (sizeof (int) * size);
+  int *out = malloc (sizeof (int) * size);
+  char *seen = calloc (size + 1, 1);
+  struct arg_elem *elem = malloc (sizeof (*elem) * size);
+  struct arg_elem *elem_out = malloc (sizeof (*elem) * size);
+  if (input == NULL || out == NULL || seen == NULL || elem == NULL
+      || elem_out == NULL)
+    {
+      printf ("Error: Could not allocate array of size %d\n", size);
+      exit (1);
+    }
+  sort_input_fill (input, size, dist);
+  int ok = sort_validate (a, size, in)
+    && check_permutation (a, size, input, seen, out, elem, elem_out);
+  free (input);
+  free (out);
+  free (seen);
+  free (elem);
+  free (elem_out);
+  return ok;
+}
+
+// The incremental engines feed the input to a sorted_array in
+// batches, flush it and copy it back.  Each reports the mean time to
+// insert a batch, which should track the batch size rather than the
+// size of the array.
+#define RANK_SAMPLES 16
+
+static void
+incremental_failed (void)
+{
+  printf ("Error: sorted_array: out of memory\n");
+  exit (1);
+}
+
+// Insert A[0 .. SIZE - 1] into SA in batches of BATCH keys.
+static void
+insert_batches (struct sorted_array *sa, int a[], int size, int batch)
+{
+  int off;
+  for (off = 0; off < size; off += batch)
+    if (!sorted_array_insert (sa, a + off,
+			      size - off < batch ? size - off : batch))
+      incremental_failed ();
+}
+
+// The cell an incremental engine last reported
+struct incremental_cell
+{
+  int size, threads;
+};
+
+static void
+sort_incremental (int a[], int size, int threads, int batch,
+		  const char *name, struct incremental_cell *last)
+{
+  struct sorted_array *sa = sorted_array_new (threads);
+  if (sa == NULL)
+    incremental_failed ();
+  double start = get_time ();
+  insert_batches (sa, a, size, batch);
+  double end = get_time ();
+  if (!sorted_array_flush (sa))
+    incremental_failed ();
+  memcpy (a, sa->a, size * sizeof (int));
+  sorted_array_free (sa);
+  int batches = (size + batch - 1) / batch;
+  if (batches > 0 && (size != last->size || threads != last->threads))
+    printf ("%s: %d batches of %d keys, %.2f us per batch inserted\n",
+	    name, batches, batch, 1e6 * (end - start) / batches);
+  last->size = size;
+  last->threads = threads;
+}
+
+static void
+sort_incremental_1k (int a[], int size, int temp[], int threads)
+{
+  static struct incremental_cell last = { -1, 0 };
+  sort_incremental (a, size, threads, 1024, "omp_incremental_1k", &last);
+}
+
+static void
+sort_incremental_64k (int a[], int size, int temp[], int threads)
+{
+  static struct incremental_cell last = { -1, 0 };
+  sort_incremental (a, size, threads, 65536, "omp_incremental_64k", &last);
+}
+
+// A is sorted, and a sorted_array fed input DIST in batches, with
+// runs still in its side buffer, ranks sampled keys as A does.
+static int
+check_incremental (const int a[], int size, int dist,
+		   const struct sort_sum *in, int batch)
+{
+  int *input = malloc (sizeof (int) * size);
+  struct sorted_array *sa = sorted_array_new (omp_get_max_threads ());
+  int ok, i;
+  if (input == NULL || sa == NULL)
+    incremental_failed ();
+  ok = sort_validate (a, size, in);
+  sort_input_fill (input, size, dist);
+  insert_batches (sa, input, size, batch);
+  for (i = 0; ok && size > 0 && i < RANK_SAMPLES; i++)
+    {
+      int key = a[(long) size * i / RANK_SAMPLES] + i % 2;
+      long lo = 0, hi = size;
+      while (lo < hi)
+	{
+	  long mid = lo + (hi - lo) / 2;
+	  if (a[mid] < key)
+	    lo = mid + 1;
+	  else
+	    hi = mid;
+	}
+      if (sorted_array_rank (sa, key) != lo)
+	{
+	  printf ("Implementation error: sorted_array_rank (%d) = %ld,"
+		  " not %ld\n", key, sorted_array_rank (sa, key), lo);
+	  ok = 0;
+	}
+    }
+  sorted_array_free (sa);
+  free (input);
+  return ok;
+}
+
+static int
+check_incremental_1k (const int a[], int size, int dist,
+		      const struct sort_sum *in)
+{
+  return check_incremental (a, size, dist, in, 1024);
+}
+
+static int
+check_incremental_64k (const int a[], int size, int dist,
+		       const struct sort_sum *in)
+{
+  return check_incremental (a, size, dist, in, 65536);
+}
+
+// The selection engines take the BENCH_K smallest keys, or the
+// quantiles bench_q, and are checked against a full sort.
+#define BENCH_K 1000
+static const double bench_q[] = { 0, 0.01, 0.25, 0.5, 0.75, 0.99, 1 };
+#define BENCH_N_Q ((int) (sizeof (bench_q) / sizeof (bench_q[0])))
+static int select_out[BENCH_K > BENCH_N_Q ? BENCH_K : BENCH_N_Q];
+
+static int
+bench_k (int size)
+{
+  return size < BENCH_K ? size : BENCH_K;
+}
+
+static void
+select_failed (const char *name)
+{
+  printf ("Error: %s: out of memory\n", name);
+  exit (1);
+}
+
+static void
+sort_topk (int a[], int size, int temp[], int threads)
+{
+  if (!topk_omp (a, size, bench_k (size), select_out, temp, threads))
+    select_failed ("topk_omp");
+}
+
+static void
+sort_partial (int a[], int size, int temp[], int threads)
+{
+  if (!partial_sort_omp (a, size, bench_k (size), temp, threads))
+    select_failed ("partial_sort_omp");
+}
+
+static void
+sort_quantiles (int a[], int size, int temp[], int threads)
+{
+  if (size > 0
+      && !quantiles_omp (a, size, bench_q, BENCH_N_Q, select_out, threads))
+    select_failed ("quantiles_omp");
+}
+
+// Input DIST, of SIZE keys, sorted
+static int *
+sorted_input (int size, int dist)
+{
+  int *sorted = malloc (sizeof (int) * size);
+  int *temp = malloc (sizeof (int) * size);
+  if (sorted == NULL || temp == NULL)
+    {
+      printf ("Error: Could not allocate array of size %d\n", size);
+      exit (1);
+    }
+  sort_input_fill (sorted, size, dist);
+  mergesort_serial (sorted, size, temp);
+  free (temp);
+  return sorted;
+}
+
+// A is of the keys of IN; if so, N results in OUT are those of SORTED
+// at RANK (i).
+static int
+check_select (const char *name, const int a[], int size,
+	      const struct sort_sum *in, const int out[], int n,
+	      const int sorted[], long (*rank) (int i, int size))
+{
+  struct sort_sum s = sort_checksum (a, size);
+  int i;
+  if (s.sum != in->sum || s.hash != in->hash)
+    {
+      printf ("Implementation error: %s changed the keys\n", name);
+      return 0;
+    }
+  for (i = 0; i < n; i++)
+    if (out[i] != sorted[rank (i, size)])
+      {
+	printf ("Implementation error: %s result %d is %d, not %d\n", name,
+		i, out[i], sorted[rank (i, size)]);
+	return 0;
+      }
+  return 1;
+}
+
+static long
+rank_prefix (int i, int size)
+{
+  return i;
+}
+
+static long
+rank_quantile (int i, int size)
+{
+  return (long) (bench_q[i] * (size - 1));
+}
+
+// select_out is the sorted BENCH_K smallest, and A unchanged.
+static int
+check_topk (const int a[], int size, int dist, const struct sort_sum *in)
+{
+  int *sorted = sorted_input (size, dist);
+  int ok = check_select ("topk_omp", a, size, in, select_out, bench_k (size),
+			 sorted, rank_prefix);
+  free (sorted);
+  return ok;
+}
+
+// A begins with the sorted BENCH_K smallest, and none of the rest is
+// less than the last of them.
+static int
+check_partial (const int a[], int size, int dist, const struct sort_sum *in)
+{
+  int *sorted = sorted_input (size, dist), k = bench_k (size), i;
+  int ok = check_select ("partial_sort_omp", a, size, in, a, k, sorted,
+			 rank_prefix);
+  for (i = k; ok && i < size; i++)
+    if (a[i] < a[k - 1])
+      {
+	printf ("Implementation error: partial_sort_omp: a[%d] < a[%d]\n",
+		i, k - 1);
+	ok = 0;
+      }
+  free (sorted);
+  return ok;
+}
+
+// select_out holds the keys of rank bench_q * (SIZE - 1).
+static int
+check_quantiles (const int a[], int size, int dist,
+		 const struct sort_sum *in)
+{
+  int *sorted = sorted_input (size, dist);
+  int ok = check_select ("quantiles_omp", a, size, in, select_out,
+			 size > 0 ? BENCH_N_Q : 0, sorted, rank_quantile);
+  free (sorted);
+  return ok;
+}
+
+// The counts of omp_count, and the groups of the last omp_unique or
+// omp_count run, kept between runs
+static int *group_counts;
+static int group_counts_size = -1, group_n;
+
+static void
+sort_unique_keys (int a[], int size, int temp[], int threads)
+{
+  group_n = sort_unique (a, size, temp, threads);
+}
+
+static void
+sort_count_keys (int a[], int size, int temp[], int threads)
+{
+  if (size > group_counts_size)
+    {
+      free (group_counts);
+      group_counts = malloc (sizeof (int) * (size + 1));
+      if (group_counts == NULL)
+	{
+	  printf ("Error: Could not allocate array of size %d\n", size + 1);
+	  exit (1);
+	}
+      group_counts_size = size;
+    }
+  group_n = sort_count (a, size, temp, group_counts, threads);
+}
+
+// A[0 .. group_n - 1] are the distinct keys of input DIST, in order,
+// and, if COUNTS is not NULL, COUNTS the number of each.
+static int
+check_groups (const int a[], int size, int dist, const struct sort_sum *in,
+	      const int counts[])
+{
+  int *sorted = sorted_input (size, dist), g = 0, i, ok = 1;
+  if (!sort_validate_counts (a, counts, group_n, in))
+    ok = 0;
+  for (i = 0; ok && i < size; i++)
+    if (i == 0 || sorted[i] != sorted[i - 1])
+      {
+	int n = 1;
+	while (i + n < size && sorted[i + n] == sorted[i])
+	  n++;
+	if (g >= group_n || a[g] != sorted[i]
+	    || (counts != NULL && counts[g] != n))
+	  {
+	    printf ("Implementation error: group %d is not key %d, %d times\n",
+		    g, sorted[i], n);
+	    ok = 0;
+	  }
+	g++;
+      }
+  if (ok && g != group_n)
+    {
+      printf ("Implementation error: %d groups, not %d\n", group_n, g);
+      ok = 0;
+    }
+  free (sorted);
+  return ok;
+}
+
+static int
+check_unique (const int a[], int size, int dist, const struct sort_sum *in)
+{
+  return check_groups (a, size, dist, in, NULL);
+}
+
+static int
+check_count (const int a[], int size, int dist, const struct sort_sum *in)
+{
+  return check_groups (a, size, dist, in, group_counts);
+}
+
+// The first is the baseline of the speedups.
+static const struct engine engine_table[] = {
+  {"serial_mergesort", ENGINE_SERIAL, sort_serial},
+  {"omp_mergesort", ENGINE_OMP, run_omp},
+  {"natural_mergesort", ENGINE_SERIAL, sort_natural},
+  {"omp_natural_mergesort", ENGINE_OMP, natural_mergesort_omp},
+  {"omp_lsd_radix8", ENGINE_OMP, sort_lsd_radix8},
+  {"omp_lsd_radix11", ENGINE_OMP, sort_lsd_radix11},
+  {"omp_msd_radix", ENGINE_OMP, radix_msd_omp},
+  {"omp_dispatch", ENGINE_OMP, sort_dispatch},
+  {"omp_group", ENGINE_OMP, sort_group},
+  {"omp_unique", ENGINE_OMP, sort_unique_keys, check_unique},
+  {"omp_count", ENGINE_OMP, sort_count_keys, check_count},
+  {"omp_segmented", ENGINE_OMP, sort_segmented, check_segmented},
+  {"argsort", ENGINE_SERIAL, sort_argsort, check_argsort},
+  {"omp_argsort", ENGINE_OMP, sort_argsort, check_argsort},
+  {"omp_incremental_1k", ENGINE_OMP, sort_incremental_1k,
+   check_incremental_1k},
+  {"omp_incremental_64k", ENGINE_OMP, sort_incremental_64k,
+   check_incremental_64k},
+  {"omp_topk", ENGINE_OMP, sort_topk, check_topk},
+  {"omp_partial_sort", ENGINE_OMP, sort_partial, check_partial},
+  {"omp_quantiles", ENGINE_OMP, sort_quantiles, check_quantiles},
+  {"mpi_mergesort", ENGINE_MPI},
+  {"mpi_rma_mergesort", ENGINE_MPI},
+  {"mpi_rma_nc_mergesort", ENGINE_MPI},
+  {"mpi_hier_mergesort", ENGINE_MPI},
+  {"hybrid_mergesort", ENGINE_MPI_HYBRID},
+  {"upc_hybrid_mergesort", ENGINE_UPC_HYBRID},
+  {"upc_mergesort", ENGINE_UPC},
+  {"upc_no_copy_mergesort", ENGINE_UPC},
+};
+
+#define N_ENGINES ((int) (sizeof (engine_table) / sizeof (engine_table[0])))
+
+static struct
+{
+  const struct engine *engine[N_ENGINES];
+  int n_engines;
+  int size[MAX_LIST], n_sizes;
+  int procs[MAX_LIST], n_procs;
+  int threads[MAX_LIST], n_threads;
+  int dist[DIST_N], n_dists;
+  int reps, warmup;
+  const char *launcher;
+  const char *prefix;
+  const char *baseline;
+  double threshold, alpha;
+} opt;
+
+static struct result *results;
+static int n_results;
+static struct result *baseline;
+static int n_baseline;
+
+static void
+usage (const char *prog)
+{
+  int i;
+  printf ("Usage: %s [options]\n"
+	  "  -e ENGINES   comma separated engines (default: all)\n"
+	  "  -n SIZES     comma separated array sizes; k, M, G suffixes"
+	  " (default: 10M)\n"
+	  "  -p PROCS     comma separated total process/thread counts\n"
+	  "               (default: 1, 2, 4, ... up to the online CPUs)\n"
+	  "  -t THREADS   comma separated OpenMP threads per rank for the\n"
+	  "               hybrid engines (default: 1 if P = 1, else P/2\n"
+	  "               if P < 8, else P/4)\n"
+	  "  -d DISTS     comma separated input distributions"
+	  " (default: random)\n"
+	  "  -r REPS      measured repetitions (default: 5)\n"
+	  "  -w WARMUP    discarded warmup runs (default: 1)\n"
+	  "  -L LAUNCHER  MPI launcher; %%d is replaced by the number of\n"
+	  "               ranks (default: \"mpirun -n %%d\")\n"
+	  "  -o PREFIX    write PREFIX.csv and PREFIX.json"
+	  " (default: bench_results)\n"
+	  "  -b FILE      compare with the results in FILE, a JSON file\n"
+	  "               written by an earlier run; the same cells are\n"
+	  "               measured, and the -e, -n, -p, -t and -d options\n"
+	  "               are ignored.  Exits with 3 if any cell regressed\n"
+	  "  -T PERCENT   regression threshold for -b (default: 5)\n"
+	  "  -a ALPHA     significance level for -b (default: 0.05)\n"
+	  "  -A           autotune the parameters of sort_tune.h for the\n"
+	  "               first -n size and the largest -p count, and\n"
+	  "               write them to this host's profile\n"
+	  "  -V           skip the result checks (see sort_validate.h)\n",
+	  prog);
+  printf ("Engines:");
+  for (i = 0; i < N_ENGINES; i++)
+    printf (" %s", engine_table[i].name);
+  printf ("\nDistributions:");
+  for (i = 0; i < DIST_N; i++)
+    printf (" %s", sort_dist_name[i]);
+  printf ("\n");
+}
+
+static int
+parse_count (const char *s, int *value)
+{
+  char *end;
+  double v = strtod (s, &end);
+  switch (*end)
+    {
+    case 'k':
+    case 'K':
+      v *= 1.0e3, end++;
+      break;
+    case 'm':
+    case 'M':
+      v *= 1.0e6, end++;
+      break;
+    case 'g':
+    case 'G':
+      v *= 1.0e9, end++;
+      break;
+    }
+  if (end == s || *end != '\0' || v < 1.0 || v > 2147483647.0)
+    return 0;
+  *value = (int) v;
+  return 1;
+}
+
+// Split the comma separated LIST, and call PARSE on each item.
+// Returns the number of items, or -1 on error.
+static int
+parse_list (char *list, int max, int (*parse) (const char *, int *),
+	    int value[])
+{
+  int n = 0;
+  char *item, *save;
+  for (item = strtok_r (list, ",", &save); item != NULL;
+       item = strtok_r (NULL, ",", &save))
+    {
+      if (n == max || !parse (item, &value[n]))
+	{
+	  fprintf (stderr, "Error: bad list item: %s\n", item);
+	  return -1;
+	}
+      n++;
+    }
+  return n;
+}
+
+const struct engine *
+bench_engine_lookup (const char *name)
+{
+  int i;
+  for (i = 0; i < N_ENGINES; i++)
+    if (strcmp (name, engine_table[i].name) == 0)
+      return &engine_table[i];
+  return NULL;
+}
+
+static int
+parse_engine (const char *name, int *value)
+{
+  const struct engine *e = bench_engine_lookup (name);
+  if (e != NULL)
+    *value = e - engine_table;
+  return e != NULL;
+}
+
+static int
+parse_dist (const char *name, int *value)
+{
+  *value = sort_dist_lookup (name);
+  return *value >= 0;
+}
+
+static int
+compare_double (const void *p1, const void *p2)
+{
+  double d1 = *(const double *) p1, d2 = *(const double *) p2;
+  return (d1 > d2) - (d1 < d2);
+}
+
+void
+bench_summarize (struct result *r)
+{
+  double s[MAX_SAMPLES], sum = 0.0;
+  int i, n = r->n_samples;
+  r->min = r->median = r->p95 = r->mean = NAN;
+  r->speedup = r->efficiency = NAN;
+  if (n == 0)
+    return;
+  memcpy (s, r->sample, n * sizeof (double));
+  qsort (s, n, sizeof (double), compare_double);
+  for (i = 0; i < n; i++)
+    sum += s[i];
+  r->min = s[0];
+  r->median = (n % 2) ? s[n / 2] : (s[n / 2 - 1] + s[n / 2]) / 2.0;
+  // Nearest rank.
+  r->p95 = s[(int) ceil (0.95 * n) - 1];
+  r->mean = sum / n;
+}
+
+// Sort SIZE elements of input DIST in-process; returns the elapsed
+// time, or a negative value if the result is not a sorted
+// permutation of the input.
+static double
+run_in_process (const struct engine *e, int a[], int temp[], int size,
+		int dist, int threads)
+{
+  struct sort_sum in = { 0, 0 };
+  int validate = sort_validate_enabled ();
+  sort_input_fill (a, size, dist);
+  if (validate)
+    in = sort_checksum (a, size);
+  double start = get_time ();
+  e->sort (a, size, temp, threads);
+  double end = get_time ();
+  if (validate
+      && !(e->check != NULL ? e->check (a, size, dist, &in)
+	   : sort_validate (a, size, &in)))
+    return -1.0;
+  return end - start;
+}
+
+// Expand "%d" in the launcher template to RANKS.
+static void
+launcher_command (char *cmd, size_t len, int ranks)
+{
+  const char *fmt = opt.launcher, *p = strstr (fmt, "%d");
+  if (p == NULL)
+    snprintf (cmd, len, "%s", fmt);
+  else
+    snprintf (cmd, len, "%.*s%d%s", (int) (p - fmt), fmt, ranks, p + 2);
+}
+
+static void
+engine_command (char *cmd, size_t len, const struct result *r)
+{
+  char launch[1024];
+  const char *name = r->engine->name;
+  switch (r->engine->kind)
+    {
+    case ENGINE_MPI:
+      launcher_command (launch, sizeof (launch), r->ranks);
+      snprintf (cmd, len, "%s ./%s %d 2>&1", launch, name, r->size);
+      break;
+    case ENGINE_MPI_HYBRID:
+      launcher_command (launch, sizeof (launch), r->ranks);
+      snprintf (cmd, len, "%s ./%s %d %d 2>&1", launch, name, r->size,
+		r->threads);
+      break;
+    case ENGINE_UPC:
+      snprintf (cmd, len, "./%s -n %d %d 2>&1", name, r->ranks, r->size);
+      break;
+    case ENGINE_UPC_HYBRID:
+      snprintf (cmd, len, "./%s -n %d %d %d 2>&1", name, r->ranks, r->size,
+		r->threads);
+      break;
+    default:
+      abort ();
+    }
+}
+
+// Run CMD, which redirects its stderr to stdout; returns the
+// "Elapsed = " time, or a negative value if the program failed or
+// its result check did.
+static double
+run_command (const char *cmd, char counters[], size_t len)
+{
+  char line[1024];
+  double elapsed = -1.0;
+  int failed = 0;
+  FILE *p = popen (cmd, "r");
+  if (p == NULL)
+    {
+      perror ("popen");
+      return -1.0;
+    }
+  while (fgets (line, sizeof (line), p) != NULL)
+    {
+      if (sscanf (line, "Elapsed = %lf", &elapsed) == 1)
+	continue;
+      if (strncmp (line, "Counters = ", 11) == 0)
+	{
+	  size_t n = strcspn (line + 11, "\n");
+	  if (n >= len)
+	    n = len - 1;
+	  memcpy (counters, line + 11, n);
+	  counters[n] = '\0';
+	}
+      else if (strstr (line, "Implementation error") != NULL
+	       || strncmp (line, "Error", 5) == 0)
+	failed = 1;
+    }
+  int status = pclose (p);
+  if (status == -1 || !WIFEXITED (status) || WEXITSTATUS (status) != 0)
+    failed = 1;
+  return failed ? -1.0 : elapsed;
+}
+
+static struct result *
+new_result (const struct engine *e, int dist, int size, int procs,
+	    int ranks, int threads)
+{
+  static int max_results;
+  if (n_results == max_results)
+    {
+      max_results = max_results ? 2 * max_results : 64;
+      results = realloc (results, max_results * sizeof (struct result));
+      if (results == NULL)
+	{
+	  printf ("Error: Could not allocate results\n");
+	  exit (1);
+	}
+    }
+  struct result *r = &results[n_results++];
+  memset (r, 0, sizeof (*r));
+  r->engine = e;
+  r->dist = dist;
+  r->size = size;
+  r->procs = procs;
+  r->ranks = ranks;
+  r->threads = threads;
+  r->status = "ok";
+  r->change = r->p_value = NAN;
+  return r;
+}
+
+void
+bench_measure (struct result *r, int a[], int temp[])
+{
+  const struct engine *e = r->engine;
+  char cmd[2048];
+  int i, in_process = e->sort != NULL;
+  if (!in_process)
+    {
+      if (r->dist != DIST_RANDOM)
+	{
+	  r->status = "skipped";
+	  bench_summarize (r);
+	  return;
+	}
+      if (access (e->name, X_OK) != 0)
+	{
+	  r->status = "unavailable";
+	  bench_summarize (r);
+	  return;
+	}
+      engine_command (cmd, sizeof (cmd), r);
+    }
+  for (i = -opt.warmup; i < opt.reps; i++)
+    {
+      double t = in_process
+	? run_in_process (e, a, temp, r->size, r->dist, r->threads)
+	: run_command (cmd, r->counters, sizeof (r->counters));
+      if (t < 0.0)
+	{
+	  r->status = "failed";
+	  r->n_samples = 0;
+	  break;
+	}
+      if (i >= 0)
+	r->sample[r->n_samples++] = t;
+    }
+  bench_summarize (r);
+}
+
+// Ranks x threads for a hybrid engine with PROCS processors in all:
+// the -t list if given, else the host profile's threads per rank if
+// they divide PROCS, else the split that perf-test used.
+static int
+hybrid_split (int procs, int ranks[], int threads[])
+{
+  int i, n = 0;
+  if (opt.n_threads == 0)
+    {
+      int t = sort_tune.hybrid_threads;
+      if (t > 0 && t <= procs && procs % t == 0)
+	threads[0] = t;
+      else
+	threads[0] = procs == 1 ? 1 : procs < 8 ? procs / 2 : procs / 4;
+      ranks[0] = procs / threads[0];
+      return 1;
+    }
+  for (i = 0; i < opt.n_threads; i++)
+    if (procs % opt.threads[i] == 0)
+      {
+	threads[n] = opt.threads[i];
+	ranks[n++] = procs / opt.threads[i];
+      }
+  return n;
+}
+
+// The ranks x threads configurations of engine E to measure at PROCS
+// processors: those of the baseline, when comparing with one.
+static int
+configurations (const struct engine *e, int size, int dist, int procs,
+		int ranks[], int threads[])
+{
+  int i, n = 0;
+  if (opt.baseline != NULL)
+    {
+      for (i = 0; i < n_baseline && n < MAX_LIST; i++)
+	{
+	  const struct result *b = &baseline[i];
+	  if (b->engine == e && b->size == size && b->dist == dist
+	      && b->procs == procs)
+	    {
+	      ranks[n] = b->ranks;
+	      threads[n++] = b->threads;
+	    }
+	}
+      return n;
+    }
+  if (e->kind == ENGINE_SERIAL)
+    {
+      ranks[0] = 1, threads[0] = 1;
+      return procs == 1;
+    }
+  if (e->kind == ENGINE_OMP)
+    {
+      ranks[0] = 1, threads[0] = procs;
+      return 1;
+    }
+  if (e->kind == ENGINE_MPI || e->kind == ENGINE_UPC)
+    {
+      ranks[0] = procs, threads[0] = 1;
+      return 1;
+    }
+  return hybrid_split (procs, ranks, threads);
+}
+
+// Add VALUE to the LIST of N values, unless already there.
+static void
+add_unique (int list[], int *n, int max, int value)
+{
+  int i;
+  for (i = 0; i < *n; i++)
+    if (list[i] == value)
+      return;
+  if (*n < max)
+    list[(*n)++] = value;
+}
+
+// Measure the cells of the baseline: its engines, sizes, process
+// counts and inputs, and its repetitions unless given.
+static int
+use_baseline (int engine[], int reps_given, int warmup_given)
+{
+  int i, reps = opt.reps, warmup = opt.warmup;
+  n_baseline = bench_load (opt.baseline, &baseline, &reps, &warmup);
+  if (n_baseline <= 0)
+    {
+      if (n_baseline == 0)
+	fprintf (stderr, "Error: %s: no results\n", opt.baseline);
+      return 0;
+    }
+  if (!reps_given && reps >= 1 && reps <= MAX_SAMPLES)
+    opt.reps = reps;
+  if (!warmup_given && warmup >= 0)
+    opt.warmup = warmup;
+  opt.n_engines = opt.n_sizes = opt.n_procs = opt.n_dists = 0;
+  for (i = 0; i < n_baseline; i++)
+    {
+      const struct result *b = &baseline[i];
+      add_unique (engine, &opt.n_engines, N_ENGINES,
+		  b->engine - engine_table);
+      add_unique (opt.size, &opt.n_sizes, MAX_LIST, b->size);
+      add_unique (opt.procs, &opt.n_procs, MAX_LIST, b->procs);
+      add_unique (opt.dist, &opt.n_dists, DIST_N, b->dist);
+    }
+  return 1;
+}
+
+static void
+print_ratio (const char *label, const struct result *row[], int efficiency)
+{
+  int j;
+  printf ("  %-22s", label);
+  for (j = 0; j < opt.n_procs; j++)
+    {
+      double v = row[j] == NULL ? NAN
+	: efficiency ? row[j]->efficiency : row[j]->speedup;
+      if (isnan (v))
+	printf ("%9s", "-");
+      else
+	printf ("%9.2f", v);
+    }
+  printf ("\n");
+}
+
+// Print the median times of the results from FIRST on, which are for
+// one size and distribution, as a table of engines x process counts.
+static void
+print_table (int first, int size, int dist)
+{
+  int e, j, k;
+  printf ("\nN = %d, input = %s, median of %d (seconds)\n",
+	  size, sort_dist_name[dist], opt.reps);
+  printf ("%-24s", "");
+  for (j = 0; j < opt.n_procs; j++)
+    printf ("%9d", opt.procs[j]);
+  printf ("\n");
+  for (e = 0; e < opt.n_engines; e++)
+    {
+      const struct result *row[MAX_LIST];
+      int any = 0, counters = 0;
+      memset (row, 0, sizeof (row));
+      // The first configuration of each process count.
+      for (k = n_results - 1; k >= first; k--)
+	if (results[k].engine == opt.engine[e])
+	  for (j = 0; j < opt.n_procs; j++)
+	    if (results[k].procs == opt.procs[j])
+	      {
+		row[j] = &results[k];
+		// Not built, or not applicable to this input
+		any |= strcmp (results[k].status, "unavailable") != 0
+		  && strcmp (results[k].status, "skipped") != 0;
+		counters |= results[k].counters[0] != '\0';
+	      }
+      if (!any)
+	continue;
+      printf ("%-24s", opt.engine[e]->name);
+      for (j = 0; j < opt.n_procs; j++)
+	if (row[j] == NULL)
+	  printf ("%9s", "");
+	else if (row[j]->n_samples == 0)
+	  printf ("%9s", "N/A");
+	else
+	  printf ("%9.4f", row[j]->median);
+      printf ("\n");
+      if (opt.engine[e] != &engine_table[0])
+	{
+	  print_ratio ("speedup", row, 0);
+	  print_ratio ("efficiency", row, 1);
+	}
+      if (counters)
+	{
+	  static const char *const metric[] = {
+	    "ipc", "llc_misses/elem", "branch_misses/elem", "GB/s"
+	  };
+	  int m;
+	  for (m = 0; m < 4; m++)
+	    {
+	      size_t len = strlen (metric[m]);
+	      printf ("  %-22s", metric[m]);
+	      for (j = 0; j < opt.n_procs; j++)
+		{
+		  const char *c = row[j] ? row[j]->counters : "";
+		  const char *v = NULL;
+		  for (; (c = strstr (c, metric[m])) != NULL; c += len)
+		    if (c[len] == '=' && (c == row[j]->counters
+					  || c[-1] == ' '))
+		      {
+			v = c + len + 1;
+			break;
+		      }
+		  if (v == NULL)
+		    printf ("%9s", "N/A");
+		  else
+		    printf ("%9.*s", (int) strcspn (v, " "), v);
+		}
+	      printf ("\n");
+	    }
+	}
+    }
+}
+
+// Unknown values are empty in the CSV file, and null in the JSON file.
+static void
+csv_number (FILE * f, double v)
+{
+  if (!isnan (v))
+    fprintf (f, "%.9g", v);
+  fputc (',', f);
+}
+
+static void
+json_number (FILE * f, double v)
+{
+  if (isnan (v))
+    fputs ("null", f);
+  else
+    fprintf (f, "%.9g", v);
+}
+
+static int
+write_results (void)
+{
+  char name[4096], host[256];
+  int i, k;
+  time_t now = time (NULL);
+  char date[64];
+  strftime (date, sizeof (date), "%Y-%m-%dT%H:%M:%S%z", localtime (&now));
+  if (gethostname (host, sizeof (host)) != 0)
+    strcpy (host, "unknown");
+  host[sizeof (host) - 1] = '\0';
+
+  snprintf (name, sizeof (name), "%s.csv", opt.prefix);
+  FILE *f = fopen (name, "w");
+  if (f == NULL)
+    {
+      perror (name);
+      return 0;
+    }
+  fprintf (f, "engine,input,n,p,ranks,threads,reps,min,median,p95,mean,"
+	   "speedup,efficiency,status\n");
+  for (k = 0; k < n_results; k++)
+    {
+      const struct result *r = &results[k];
+      fprintf (f, "%s,%s,%d,%d,%d,%d,%d,", r->engine->name,
+	       sort_dist_name[r->dist], r->size, r->procs, r->ranks,
+	       r->threads, r->n_samples);
+      csv_number (f, r->min);
+      csv_number (f, r->median);
+      csv_number (f, r->p95);
+      csv_number (f, r->mean);
+      csv_number (f, r->speedup);
+      csv_number (f, r->efficiency);
+      fprintf (f, "%s\n", r->status);
+    }
+  fclose (f);
+
+  snprintf (name, sizeof (name), "%s.json", opt.prefix);
+  f = fopen (name, "w");
+  if (f == NULL)
+    {
+      perror (name);
+      return 0;
+    }
+  fprintf (f, "{\"host\":\"%s\",\"date\":\"%s\",\"cpus\":%ld,"
+	   "\"reps\":%d,\"warmup\":%d,\"results\":[",
+	   host, date, sysconf (_SC_NPROCESSORS_ONLN), opt.reps, opt.warmup);
+  for (k = 0; k < n_results; k++)
+    {
+      const struct result *r = &results[k];
+      fprintf (f, "%s\n{\"engine\":\"%s\",\"input\":\"%s\",\"n\":%d,"
+	       "\"p\":%d,\"ranks\":%d,\"threads\":%d,\"status\":\"%s\"",
+	       k ? "," : "", r->engine->name, sort_dist_name[r->dist],
+	       r->size, r->procs, r->ranks, r->threads, r->status);
+      fputs (",\"min\":", f);
+      json_number (f, r->min);
+      fputs (",\"median\":", f);
+      json_number (f, r->median);
+      fputs (",\"p95\":", f);
+      json_number (f, r->p95);
+      fputs (",\"mean\":", f);
+      json_number (f, r->mean);
+      fputs (",\"speedup\":", f);
+      json_number (f, r->speedup);
+      fputs (",\"efficiency\":", f);
+      json_number (f, r->efficiency);
+      fputs (",\"samples\":[", f);
+      for (i = 0; i < r->n_samples; i++)
+	fprintf (f, "%s%.9g", i ? "," : "", r->sample[i]);
+      fputs ("]", f);
+      if (r->counters[0])
+	fprintf (f, ",\"counters\":\"%s\"", r->counters);
+      if (r->base != NULL)
+	{
+	  fputs (",\"baseline_median\":", f);
+	  json_number (f, r->base->median);
+	  fputs (",\"change\":", f);
+	  json_number (f, r->change);
+	  fputs (",\"p_value\":", f);
+	  json_number (f, r->p_value);
+	  fprintf (f, ",\"verdict\":\"%s\"", r->verdict);
+	}
+      fputs ("}", f);
+    }
+  fputs ("\n]}\n", f);
+  fclose (f);
+  printf ("\nResults written to %s.csv and %s.json\n", opt.prefix,
+	  opt.prefix);
+  return 1;
+}
+
+int
+main (int argc, char *argv[])
+{
+  int engine[N_ENGINES], c, i, j, k, s, d;
+  int reps_given = 0, warmup_given = 0, autotune = 0;
+  opt.n_engines = -1;
+  opt.reps = 5;
+  opt.warmup = 1;
+  opt.launcher = "mpirun -n %d";
+  opt.prefix = "bench_results";
+  opt.threshold = 0.05;
+  opt.alpha = 0.05;
+  while ((c = getopt (argc, argv, "e:n:p:t:d:r:w:L:o:b:T:a:AVh")) != -1)
+    {
+      int ok = 1;
+      switch (c)
+	{
+	case 'e':
+	  ok = (opt.n_engines = parse_list (optarg, N_ENGINES, parse_engine,
+					    engine)) > 0;
+	  break;
+	case 'n':
+	  ok = (opt.n_sizes = parse_list (optarg, MAX_LIST, parse_count,
+					  opt.size)) > 0;
+	  break;
+	case 'p':
+	  ok = (opt.n_procs = parse_list (optarg, MAX_LIST, parse_count,
+					  opt.procs)) > 0;
+	  break;
+	case 't':
+	  ok = (opt.n_threads = parse_list (optarg, MAX_LIST, parse_count,
+					    opt.threads)) > 0;
+	  break;
+	case 'd':
+	  ok = (opt.n_dists = parse_list (optarg, DIST_N, parse_dist,
+					  opt.dist)) > 0;
+	  break;
+	case 'r':
+	  opt.reps = atoi (optarg);
+	  ok = opt.reps >= 1 && opt.reps <= MAX_SAMPLES;
+	  reps_given = 1;
+	  break;
+	case 'w':
+	  opt.warmup = atoi (optarg);
+	  ok = opt.warmup >= 0;
+	  warmup_given = 1;
+	  break;
+	case 'L':
+	  opt.launcher = optarg;
+	  break;
+	case 'o':
+	  opt.prefix = optarg;
+	  break;
+	case 'b':
+	  opt.baseline = optarg;
+	  break;
+	case 'T':
+	  opt.threshold = atof (optarg) / 100.0;
+	  ok = opt.threshold >= 0.0;
+	  break;
+	case 'a':
+	  opt.alpha = atof (optarg);
+	  ok = opt.alpha > 0.0 && opt.alpha < 1.0;
+	  break;
+	case 'A':
+	  autotune = 1;
+	  break;
+	case 'V':
+	  // For the programs too
+	  setenv ("SORT_VALIDATE", "0", 1);
+	  break;
+	default:
+	  ok = 0;
+	}
+      if (!ok)
+	{
+	  usage (argv[0]);
+	  return 2;
+	}
+    }
+  if (optind != argc)
+    {
+      usage (argv[0]);
+      return 2;
+    }
+  if (opt.baseline != NULL && !use_baseline (engine, reps_given,
+					     warmup_given))
+    return 1;
+  if (opt.n_engines < 0)
+    for (opt.n_engines = 0; opt.n_engines < N_ENGINES; opt.n_engines++)
+      engine[opt.n_engines] = opt.n_engines;
+  for (i = 0; i < opt.n_engines; i++)
+    opt.engine[i] = &engine_table[engine[i]];
+  if (opt.n_sizes == 0)
+    opt.size[opt.n_sizes++] = 10000000;
+  if (opt.n_procs == 0)
+    {
+      long cpus = sysconf (_SC_NPROCESSORS_ONLN);
+      for (i = 1; opt.n_procs < MAX_LIST && (i == 1 || i <= cpus); i *= 2)
+	opt.procs[opt.n_procs++] = i;
+    }
+  if (opt.n_dists == 0)
+    opt.dist[opt.n_dists++] = DIST_RANDOM;
+  // Enable nested parallelism, if available
+  omp_set_nested (1);
+  // Tuning parameters of this host
+  tune_load ();
+  if (autotune)
+    {
+      int procs = 1;
+      for (i = 0; i < opt.n_procs; i++)
+	if (opt.procs[i] > procs)
+	  procs = opt.procs[i];
+      return bench_tune (opt.size[0], procs) ? 0 : 1;
+    }
+
+  for (s = 0; s < opt.n_sizes; s++)
+    {
+      int size = opt.size[s];
+      int *a = malloc (sizeof (int) * size);
+      int *temp = malloc (sizeof (int) * size);
+      if (a == NULL || temp == NULL)
+	{
+	  printf ("Error: Could not allocate array of size %d\n", size);
+	  return 1;
+	}
+      for (d = 0; d < opt.n_dists; d++)
+	{
+	  int dist = opt.dist[d], first = n_results;
+	  // The serial engine is the baseline of the speedups; it is
+	  // always measured, and reported if selected.
+	  struct result *serial =
+	    new_result (&engine_table[0], dist, size, 1, 1, 1);
+	  bench_measure (serial, a, temp);
+	  double baseline = serial->median;
+	  for (i = 0; i < opt.n_engines; i++)
+	    {
+	      const struct engine *e = opt.engine[i];
+	      if (e == &engine_table[0])
+		continue;
+	      for (j = 0; j < opt.n_procs; j++)
+		{
+		  int procs = opt.procs[j];
+		  int ranks[MAX_LIST], threads[MAX_LIST];
+		  int n_split = configurations (e, size, dist, procs,
+						ranks, threads);
+		  for (k = 0; k < n_split; k++)
+		    {
+		      struct result *r = new_result (e, dist, size, procs,
+						     ranks[k], threads[k]);
+		      bench_measure (r, a, temp);
+		      r->speedup = baseline / r->median;
+		      r->efficiency = r->speedup / procs;
+		    }
+		}
+	    }
+	  // Report the serial engine only if it was selected.
+	  serial = &results[first];
+	  serial->speedup = serial->efficiency = 1.0;
+	  for (i = 0; i < opt.n_engines; i++)
+	    if (opt.engine[i] == &engine_table[0])
+	      break;
+	  if (i == opt.n_engines)
+	    {
+	      memmove (serial, serial + 1,
+		       (n_results - first - 1) * sizeof (struct result));
+	      n_results--;
+	    }
+	  print_table (first, size, dist);
+	  fflush (stdout);
+	}
+      free (a);
+      free (temp);
+    }
+  int regressions = opt.baseline == NULL ? 0
+    : bench_compare (results, n_results, baseline, n_baseline,
+		     opt.threshold, opt.alpha);
+  if (!write_results ())
+    return 1;
+  return regressions ? 3 : 0;
+}
@@ -0,0 +1,89 @@
+/* Benchmark harness for the merge sort engines.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#define MAX_SAMPLES 1000
+
+struct sort_sum;
+
+enum engine_kind
+{
+  ENGINE_SERIAL,		// In-process
+  ENGINE_OMP,			// In-process
+  ENGINE_MPI,			// LAUNCHER ./engine N
+  ENGINE_MPI_HYBRID,		// LAUNCHER ./engine N THREADS
+  ENGINE_UPC,			// ./engine -n P N
+  ENGINE_UPC_HYBRID		// ./engine -n RANKS N THREADS
+};
+
+struct engine
+{
+  const char *name;
+  enum engine_kind kind;
+  // In-process engines: sort A of SIZE elements with THREADS threads
+  void (*sort) (int a[], int size, int temp[], int threads);
+  // Engines with more to check than one sorted array: check A, of
+  // the keys of checksum IN, sorted from input DIST, instead of
+  // sort_validate.  Returns 1 if right, else prints what is wrong.
+  int (*check) (const int a[], int size, int dist,
+		const struct sort_sum *in);
+};
+
+// One cell of the benchmark matrix.
+struct result
+{
+  const struct engine *engine;
+  int dist, size, procs, ranks, threads;
+  int n_samples;
+  double sample[MAX_SAMPLES];
+  double min, median, p95, mean;
+  double speedup, efficiency;	// NAN if not known
+  const char *status;		// "ok", or why there are no samples
+  char counters[256];		// "Counters = " line, if any
+  // Compare mode (bench_compare.c)
+  const struct result *base;	// The same cell of the baseline, if any
+  double change;		// Relative change of the median time
+  double p_value;
+  const char *verdict;
+};
+
+// bench.c
+extern const struct engine *bench_engine_lookup (const char *name);
+extern void bench_summarize (struct result *r);
+extern void bench_measure (struct result *r, int a[], int temp[]);
+
+// bench_compare.c
+extern int bench_load (const char *file, struct result **results,
+		       int *reps, int *warmup);
+extern const struct result *bench_find (const struct result results[],
+					int n_results,
+					const struct result *key);
+extern double mann_whitney_p (const double x[], int nx,
+			      const double y[], int ny);
+extern int bench_compare (struct result results[], int n_results,
+			  const struct result base[], int n_base,
+			  double threshold, double alpha);
+
+// bench_tune.c
+extern int bench_tune (int size, int procs);
+
+#endif /* BENCH_H */
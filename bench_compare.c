@@ -0,0 +1,395 @@
+/* Compare benchmark results against a stored baseline.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+// A cell regresses if its median time grew by more than THRESHOLD
+// (a fraction) and a one-sided Mann-Whitney U test finds the new
+// samples larger than the baseline's at significance level ALPHA.
+// Both conditions are needed: the test alone flags differences too
+// small to matter, and the threshold alone flags noise.  A cell of
+// the baseline that can no longer be measured also fails.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include "sort_input.h"
+#include "bench.h"
+
+// The reader below accepts the JSON files that bench writes, and
+// other files of the same shape; it is not a general JSON parser.
+
+struct json
+{
+  const char *p;
+  int error;
+};
+
+static void
+json_space (struct json *j)
+{
+  while (isspace ((unsigned char) *j->p))
+    j->p++;
+}
+
+static int
+json_accept (struct json *j, char c)
+{
+  json_space (j);
+  if (*j->p != c)
+    return 0;
+  j->p++;
+  return 1;
+}
+
+static void
+json_expect (struct json *j, char c)
+{
+  if (!json_accept (j, c))
+    j->error = 1;
+}
+
+// Read a string (without escapes) into BUF.
+static void
+json_string (struct json *j, char *buf, size_t len)
+{
+  size_t n = 0;
+  json_expect (j, '"');
+  while (!j->error && *j->p && *j->p != '"')
+    {
+      if (*j->p == '\\' && j->p[1])
+	j->p++;
+      if (n + 1 < len)
+	buf[n++] = *j->p;
+      j->p++;
+    }
+  buf[n] = '\0';
+  json_expect (j, '"');
+}
+
+static double
+json_number (struct json *j)
+{
+  char *end;
+  json_space (j);
+  if (strncmp (j->p, "null", 4) == 0)
+    {
+      j->p += 4;
+      return NAN;
+    }
+  double v = strtod (j->p, &end);
+  if (end == j->p)
+    j->error = 1;
+  j->p = end;
+  return v;
+}
+
+// Skip a value of any type.
+static void
+json_skip (struct json *j)
+{
+  char buf[16];
+  json_space (j);
+  if (*j->p == '"')
+    json_string (j, buf, sizeof (buf));
+  else if (*j->p == '[' || *j->p == '{')
+    {
+      char close = *j->p == '[' ? ']' : '}';
+      j->p++;
+      if (json_accept (j, close))
+	return;
+      do
+	{
+	  if (close == '}')
+	    {
+	      json_skip (j);
+	      json_expect (j, ':');
+	    }
+	  json_skip (j);
+	}
+      while (!j->error && json_accept (j, ','));
+      json_expect (j, close);
+    }
+  else if (strncmp (j->p, "true", 4) == 0)
+    j->p += 4;
+  else if (strncmp (j->p, "false", 5) == 0)
+    j->p += 5;
+  else
+    json_number (j);
+}
+
+static void
+json_result (struct json *j, struct result *r)
+{
+  char key[64], value[256];
+  memset (r, 0, sizeof (*r));
+  r->dist = -1;
+  r->status = "ok";
+  json_expect (j, '{');
+  do
+    {
+      json_string (j, key, sizeof (key));
+      json_expect (j, ':');
+      if (strcmp (key, "engine") == 0)
+	{
+	  json_string (j, value, sizeof (value));
+	  r->engine = bench_engine_lookup (value);
+	}
+      else if (strcmp (key, "input") == 0)
+	{
+	  json_string (j, value, sizeof (value));
+	  r->dist = sort_dist_lookup (value);
+	}
+      else if (strcmp (key, "status") == 0)
+	{
+	  json_string (j, value, sizeof (value));
+	  if (strcmp (value, "ok") != 0)
+	    r->status = "not ok";
+	}
+      else if (strcmp (key, "n") == 0)
+	r->size = (int) json_number (j);
+      else if (strcmp (key, "p") == 0)
+	r->procs = (int) json_number (j);
+      else if (strcmp (key, "ranks") == 0)
+	r->ranks = (int) json_number (j);
+      else if (strcmp (key, "threads") == 0)
+	r->threads = (int) json_number (j);
+      else if (strcmp (key, "samples") == 0)
+	{
+	  json_expect (j, '[');
+	  if (!json_accept (j, ']'))
+	    {
+	      do
+		{
+		  double v = json_number (j);
+		  if (r->n_samples < MAX_SAMPLES)
+		    r->sample[r->n_samples++] = v;
+		}
+	      while (!j->error && json_accept (j, ','));
+	      json_expect (j, ']');
+	    }
+	}
+      else
+	json_skip (j);
+    }
+  while (!j->error && json_accept (j, ','));
+  json_expect (j, '}');
+}
+
+// Load the results of FILE, as written by bench, into *RESULTS.
+// Returns the number of results, or -1 on error.
+int
+bench_load (const char *file, struct result **results, int *reps,
+	    int *warmup)
+{
+  char key[64];
+  int n = 0, max = 0;
+  FILE *f = fopen (file, "r");
+  if (f == NULL)
+    {
+      perror (file);
+      return -1;
+    }
+  fseek (f, 0, SEEK_END);
+  long len = ftell (f);
+  rewind (f);
+  char *text = malloc (len + 1);
+  if (text == NULL || fread (text, 1, len, f) != (size_t) len)
+    {
+      fprintf (stderr, "Error: could not read %s\n", file);
+      fclose (f);
+      free (text);
+      return -1;
+    }
+  fclose (f);
+  text[len] = '\0';
+
+  struct json j = { text, 0 };
+  *results = NULL;
+  json_expect (&j, '{');
+  do
+    {
+      json_string (&j, key, sizeof (key));
+      json_expect (&j, ':');
+      if (strcmp (key, "reps") == 0)
+	*reps = (int) json_number (&j);
+      else if (strcmp (key, "warmup") == 0)
+	*warmup = (int) json_number (&j);
+      else if (strcmp (key, "results") == 0)
+	{
+	  json_expect (&j, '[');
+	  if (json_accept (&j, ']'))
+	    continue;
+	  do
+	    {
+	      if (n == max)
+		{
+		  max = max ? 2 * max : 64;
+		  *results = realloc (*results, max * sizeof (struct result));
+		  if (*results == NULL)
+		    {
+		      fprintf (stderr, "Error: Could not allocate results\n");
+		      exit (1);
+		    }
+		}
+	      struct result *r = &(*results)[n];
+	      json_result (&j, r);
+	      if (r->engine == NULL || r->dist < 0)
+		fprintf (stderr, "Warning: %s: unknown engine or input;"
+			 " ignored\n", file);
+	      else
+		{
+		  bench_summarize (r);
+		  n++;
+		}
+	    }
+	  while (!j.error && json_accept (&j, ','));
+	  json_expect (&j, ']');
+	}
+      else
+	json_skip (&j);
+    }
+  while (!j.error && json_accept (&j, ','));
+  json_expect (&j, '}');
+  if (j.error)
+    fprintf (stderr, "Error: %s: malformed at offset %ld\n", file,
+	     (long) (j.p - text));
+  free (text);
+  return j.error ? -1 : n;
+}
+
+const struct result *
+bench_find (const struct result results[], int n_results,
+	    const struct result *key)
+{
+  int i;
+  for (i = 0; i < n_results; i++)
+    {
+      const struct result *r = &results[i];
+      if (r->engine == key->engine && r->dist == key->dist
+	  && r->size == key->size && r->procs == key->procs
+	  && r->ranks == key->ranks && r->threads == key->threads)
+	return r;
+    }
+  return NULL;
+}
+
+// One-sided Mann-Whitney U test: the probability, under the null
+// hypothesis of identical distributions, of a U statistic at least
+// as large as that observed for "X tends to be larger than Y".
+// Normal approximation, with continuity and tie corrections.
+double
+mann_whitney_p (const double x[], int nx, const double y[], int ny)
+{
+  double u = 0.0, ties = 0.0;
+  int i, k, n = nx + ny;
+  if (nx == 0 || ny == 0)
+    return 1.0;
+  for (i = 0; i < nx; i++)
+    for (k = 0; k < ny; k++)
+      u += x[i] > y[k] ? 1.0 : x[i] == y[k] ? 0.5 : 0.0;
+  // Tie correction: sum of t^3 - t over the groups of tied values.
+  for (i = 0; i < n; i++)
+    {
+      double v = i < nx ? x[i] : y[i - nx];
+      int t = 0, first = 1;
+      for (k = 0; k < n; k++)
+	{
+	  double w = k < nx ? x[k] : y[k - nx];
+	  if (w == v)
+	    {
+	      // Count each group once, at its first member.
+	      if (k < i)
+		first = 0;
+	      t++;
+	    }
+	}
+      if (first)
+	ties += (double) t * t * t - t;
+    }
+  double mean = nx * ny / 2.0;
+  double var = nx * ny / 12.0 * ((n + 1) - ties / ((double) n * (n - 1)));
+  if (var <= 0.0)
+    return 1.0;
+  double z = (u - mean - 0.5) / sqrt (var);
+  return 0.5 * erfc (z / sqrt (2.0));
+}
+
+// Compare each of RESULTS with the same cell of BASE, print a report,
+// and return the number of regressions.
+int
+bench_compare (struct result results[], int n_results,
+	       const struct result base[], int n_base,
+	       double threshold, double alpha)
+{
+  int i, regressions = 0;
+  printf ("\nCompared with the baseline (threshold %.1f%%, alpha %g):\n",
+	  threshold * 100.0, alpha);
+  printf ("%-24s%-15s%11s%5s%6s%8s%11s%11s%9s%9s  %s\n", "engine", "input",
+	  "n", "p", "ranks", "threads", "base", "median", "change", "p",
+	  "verdict");
+  for (i = 0; i < n_base; i++)
+    {
+      const struct result *b = &base[i];
+      struct result *r =
+	(struct result *) bench_find (results, n_results, b);
+      if (b->n_samples == 0)
+	continue;
+      if (r == NULL || r->n_samples == 0)
+	{
+	  printf ("%-24s%-15s%11d%5d%6d%8d%11.4f%11s%9s%9s  %s\n",
+		  b->engine->name, sort_dist_name[b->dist], b->size,
+		  b->procs, b->ranks, b->threads, b->median, "-", "-", "-",
+		  r == NULL ? "MISSING" : "FAILED");
+	  if (r != NULL)
+	    {
+	      r->base = b;
+	      r->verdict = "failed";
+	    }
+	  regressions++;
+	  continue;
+	}
+      r->base = b;
+      r->change = r->median / b->median - 1.0;
+      if (r->change >= 0.0)
+	{
+	  r->p_value = mann_whitney_p (r->sample, r->n_samples,
+				       b->sample, b->n_samples);
+	  r->verdict = r->change > threshold && r->p_value < alpha
+	    ? "regression" : "same";
+	}
+      else
+	{
+	  r->p_value = mann_whitney_p (b->sample, b->n_samples,
+				       r->sample, r->n_samples);
+	  r->verdict = -r->change > threshold && r->p_value < alpha
+	    ? "faster" : "same";
+	}
+      if (strcmp (r->verdict, "regression") == 0)
+	regressions++;
+      printf ("%-24s%-15s%11d%5d%6d%8d%11.4f%11.4f%+8.1f%%%9.4f  %s\n",
+	      r->engine->name, sort_dist_name[r->dist], r->size, r->procs,
+	      r->ranks, r->threads, b->median, r->median, r->change * 100.0,
+	      r->p_value, strcmp (r->verdict, "regression") == 0
+	      ? "REGRESSION" : r->verdict);
+    }
+  printf ("%d regression%s\n", regressions, regressions == 1 ? "" : "s");
+  return regressions;
+}
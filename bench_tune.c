@@ -0,0 +1,226 @@
+/* Autotune the merge sort parameters of this host.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+// "bench -A" searches the parameters of sort_tune.h one at a time,
+// each with the best values found so far, on an array of the size
+// to be sorted, and writes the best to the host's profile:
+//
+//   small           serial_mergesort, in-process
+//   task_cutoff     omp_mergesort at P threads, in-process; sections
+//                   (0) against tasks at a few cutoffs
+//   hybrid_threads  hybrid_mergesort at P processors, for each
+//                   ranks x threads split of P
+//   block_min       mpi_rma_mergesort (or upc_mergesort) at P ranks:
+//                   the largest block size per rank, of those tried,
+//                   for which sorting on rank 0 beats the block sort
+//
+// Each candidate is timed as bench times a cell (median of -r runs
+// after -w warmup runs).  The programs run by the launcher read
+// the candidate parameters from a temporary profile.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "sort_input.h"
+#include "sort_tune.h"
+#include "bench.h"
+
+static char tune_tmp_profile[] = "/tmp/sort_profile.XXXXXX";
+
+// Median time of engine NAME on SIZE elements at RANKS x THREADS,
+// with the parameters TUNE; NAN if it could not be measured.
+static double
+tune_time (const char *name, int size, int ranks, int threads,
+	   const struct sort_tune *tune, int a[], int temp[])
+{
+  static struct result r;
+  const struct engine *e = bench_engine_lookup (name);
+  memset (&r, 0, sizeof (r));
+  r.engine = e;
+  r.dist = DIST_RANDOM;
+  r.size = size;
+  r.procs = ranks * threads;
+  r.ranks = ranks;
+  r.threads = threads;
+  r.status = "ok";
+  sort_tune = *tune;
+  if (e->sort == NULL && !tune_write (tune_tmp_profile, tune, NULL))
+    return NAN;
+  bench_measure (&r, a, temp);
+  return r.n_samples ? r.median : NAN;
+}
+
+static void
+tune_report (const char *param, int value, double t, int best)
+{
+  if (isnan (t))
+    printf ("  %-16s%10d%12s\n", param, value, "N/A");
+  else
+    printf ("  %-16s%10d%12.4f%s\n", param, value, t, best ? "  *" : "");
+}
+
+// Try each of the N VALUES of parameter PARAM, at *FIELD of TUNE, and
+// keep the fastest in *FIELD.  Returns 0 if nothing could be measured.
+static int
+tune_search (const char *param, int *field, const int values[], int n,
+	     const char *name, int size, int ranks, int threads,
+	     struct sort_tune *tune, int a[], int temp[])
+{
+  double best_t = NAN;
+  int i, best = *field;
+  for (i = 0; i < n; i++)
+    {
+      *field = values[i];
+      double t = tune_time (name, size, ranks, threads, tune, a, temp);
+      int better = !isnan (t) && (isnan (best_t) || t < best_t);
+      if (better)
+	{
+	  best_t = t;
+	  best = values[i];
+	}
+      tune_report (param, values[i], t, better);
+    }
+  *field = best;
+  return !isnan (best_t);
+}
+
+// Tune for arrays of SIZE elements on PROCS processors, and write the
+// result to the host's profile.  Returns 0 on failure.
+int
+bench_tune (int size, int procs)
+{
+  static const int small[] = { 8, 12, 16, 24, 32, 48, 64, 96, 128 };
+  static const int block[] = { 64, 256, 1024, 4096, 16384, 65536 };
+  struct sort_tune tune = sort_tune;
+  char profile[4096], comment[512], host[256];
+  int values[64], n, i;
+  const char *file = tune_profile_name (profile, sizeof (profile));
+  if (file == NULL)
+    {
+      fprintf (stderr, "Error: no profile: SORT_PROFILE is empty,"
+	       " or HOME is not set\n");
+      return 0;
+    }
+  // Keep the name past the setenv below.
+  if (file != profile)
+    file = strcpy (profile, file);
+  int fd = mkstemp (tune_tmp_profile);
+  if (fd < 0)
+    {
+      perror (tune_tmp_profile);
+      return 0;
+    }
+  close (fd);
+  int *a = malloc (sizeof (int) * size);
+  int *temp = malloc (sizeof (int) * size);
+  if (a == NULL || temp == NULL)
+    {
+      printf ("Error: Could not allocate array of size %d\n", size);
+      free (a);
+      free (temp);
+      unlink (tune_tmp_profile);
+      return 0;
+    }
+  setenv ("SORT_PROFILE", tune_tmp_profile, 1);
+  printf ("Tuning for N = %d, P = %d (median seconds; * = best so far)\n",
+	  size, procs);
+
+  tune_search ("small", &tune.small, small, 9, "serial_mergesort",
+	       size, 1, 1, &tune, a, temp);
+
+  if (procs > 1)
+    {
+      // Sections over threads, or tasks down to a few multiples of
+      // the per-thread share.
+      n = 0;
+      values[n++] = 0;
+      for (i = 2; i <= 128; i *= 4)
+	if (size / (i * procs) > 4 * tune.small)
+	  values[n++] = size / (i * procs);
+      tune_search ("task_cutoff", &tune.task_cutoff, values, n,
+		   "omp_mergesort", size, 1, procs, &tune, a, temp);
+
+      if (access ("hybrid_mergesort", X_OK) == 0)
+	{
+	  double best_t = NAN;
+	  for (i = 1; i <= procs; i++)
+	    if (procs % i == 0)
+	      {
+		double t = tune_time ("hybrid_mergesort", size, procs / i, i,
+				      &tune, a, temp);
+		int better = !isnan (t) && (isnan (best_t) || t < best_t);
+		if (better)
+		  {
+		    best_t = t;
+		    tune.hybrid_threads = i;
+		  }
+		tune_report ("hybrid_threads", i, t, better);
+	      }
+	}
+
+      const char *block_engine = access ("mpi_rma_mergesort", X_OK) == 0
+	? "mpi_rma_mergesort" : access ("upc_mergesort", X_OK) == 0
+	? "upc_mergesort" : NULL;
+      if (block_engine != NULL)
+	{
+	  int found = 0;
+	  for (i = 0; i < 6 && block[i] <= size / procs; i++)
+	    {
+	      // Block sort, against the whole sort on rank 0.
+	      int block_size = block[i];
+	      tune.block_min = 0;
+	      double t_blocks = tune_time (block_engine, block_size * procs,
+					   procs, 1, &tune, a, temp);
+	      tune.block_min = block_size;
+	      double t_rank0 = tune_time (block_engine, block_size * procs,
+					  procs, 1, &tune, a, temp);
+	      printf ("  %-16s%10d%12.6f%12.6f  (blocks, rank 0)\n",
+		      "block_min", block_size, t_blocks, t_rank0);
+	      if (!isnan (t_rank0) && !isnan (t_blocks) && t_rank0 < t_blocks)
+		found = block_size;
+	    }
+	  tune.block_min = found;
+	}
+    }
+  unlink (tune_tmp_profile);
+  free (a);
+  free (temp);
+
+  time_t now = time (NULL);
+  char date[64];
+  strftime (date, sizeof (date), "%Y-%m-%d %H:%M", localtime (&now));
+  if (gethostname (host, sizeof (host)) != 0)
+    strcpy (host, "unknown");
+  host[sizeof (host) - 1] = '\0';
+  snprintf (comment, sizeof (comment),
+	    "Written by bench -A on %s, %s, for N = %d, P = %d",
+	    host, date, size, procs);
+  sort_tune = tune;
+  if (!tune_write (file, &tune, comment))
+    return 0;
+  printf ("Profile written to %s:\n", file);
+  printf ("  small = %d\n  task_cutoff = %d\n  hybrid_threads = %d\n"
+	  "  block_min = %d\n", tune.small, tune.task_cutoff,
+	  tune.hybrid_threads, tune.block_min);
+  return 1;
+}
@@ -23,12 +23,15 @@
 #include <math.h>
 #include <mpi.h>
 #include <omp.h>
-
-// Arrays size <= SMALL switches to insertion sort
-#define SMALL    32
+#include "instrument.h"
+#include "sort_tune.h"
+#include "sort_validate.h"
+#include "sort_pack.h"
+#include "sort_affinity.h"
 
 extern double get_time (void);
 void merge (int a[], int size, int temp[]);
+void merge_parallel_omp (int a[], int size, int temp[], int threads);
 void insertion_sort (int a[], int size);
 void mergesort_serial (int a[], int size, int temp[]);
 void mergesort_parallel_mpi (int a[], int size, int temp[],
@@ -40,13 +43,33 @@ void run_root_mpi (int a[], int size, int temp[], int max_rank, int tag,
 void run_node_mpi (int my_rank, int max_rank, int tag, MPI_Comm comm,
 		   int threads);
 void mergesort_parallel_omp (int a[], int size, int temp[], int threads);
+void send_streams (const int a[], int size, int dest, int tag, int threads);
+void recv_streams (int a[], int size, int source, int tag, int threads);
 int main (int argc, char *argv[]);
 
+// Merges below this size are not split over OpenMP threads.
+#define MERGE_SPLIT_MIN 65536
+// Most segments per transfer
+#define MAX_STREAMS 64
+
+// With MPI_THREAD_MULTIPLE and sort_tune.streams > 1, each half array
+// is sent as n_streams segments, each on its own duplicate of the
+// communicator and by its own OpenMP thread, so that several threads
+// drive the network at once.  Else n_streams is 1, and the master
+// thread alone communicates.
+int n_streams = 1;
+MPI_Comm stream_comm[MAX_STREAMS];
+
+// The start of segment I of an array of SIZE
+#define STREAM_OFFSET(size, i) ((int) ((long) (size) * (i) / n_streams))
+
 int
 main (int argc, char *argv[])
 {
-  // All processes
-  MPI_Init (&argc, &argv);
+  // All processes; threads other than the master communicate only
+  // with MPI_THREAD_MULTIPLE.
+  int provided;
+  MPI_Init_thread (&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
   // Enable nested parallelism, if available
   omp_set_nested (1);
   // Check processes and their ranks
@@ -55,21 +78,35 @@ main (int argc, char *argv[])
   MPI_Comm_size (MPI_COMM_WORLD, &comm_size);
   int my_rank;
   MPI_Comm_rank (MPI_COMM_WORLD, &my_rank);
+  // Tuning parameters of this host (rank 0's)
+  tune_load_mpi (MPI_COMM_WORLD);
   int max_rank = comm_size - 1;
   int tag = 123;
+  // Segments per transfer, the same on all ranks
+  int streams = provided == MPI_THREAD_MULTIPLE ? sort_tune.streams : 1;
+  if (streams > MAX_STREAMS)
+    streams = MAX_STREAMS;
+  MPI_Allreduce (&streams, &n_streams, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+  if (n_streams < 1)
+    n_streams = 1;
+  if (n_streams > 1)
+    for (int i = 0; i < n_streams; i++)
+      MPI_Comm_dup (MPI_COMM_WORLD, &stream_comm[i]);
   // Check arguments
-  if (argc != 3)		/* argc must be 3 for proper execution! */
+  if (argc != 2 && argc != 3)	/* argc must be 2 or 3 for proper execution! */
     {
       if (my_rank == 0)
 	{
-	  printf ("Usage: %s array-size OMP-threads-per-MPI-process>0\n",
+	  printf ("Usage: %s array-size [OMP-threads-per-MPI-process>0]\n",
 		  argv[0]);
 	}
       MPI_Abort (MPI_COMM_WORLD, 1);
     }
   // Get arguments
   int size = atoi (argv[1]);	// Array size 
-  int threads = atoi (argv[2]);	// Requested number of threads per node
+  // Requested number of threads per node, else the host's profile's
+  int threads = argc == 3 ? atoi (argv[2])
+    : sort_tune.hybrid_threads > 0 ? sort_tune.hybrid_threads : 1;
   if (threads < 1)
     {
       if (my_rank == 0)
@@ -80,6 +117,9 @@ main (int argc, char *argv[])
 	}
       MPI_Abort (MPI_COMM_WORLD, 1);
     }
+  // Placement of the threads, by $SORT_AFFINITY, with the ranks in
+  // the order of their subtrees
+  affinity_init_mpi (MPI_COMM_WORLD, affinity_tree_key (my_rank), threads);
   // Set test data
   if (my_rank == 0)
     {				// Only root process sets test data 
@@ -87,6 +127,9 @@ main (int argc, char *argv[])
 	("-Multilevel parallel Recursive Mergesort with MPI and OpenMP-\t");
       printf ("Array size = %d\nProcesses = %d\nThreads per process = %d\n",
 	      size, comm_size, threads);
+      if (n_streams > 1)
+	printf ("Streams = %d\n", n_streams);
+      affinity_print ();
       // Check nested parallelism availability
       if (omp_get_nested () != 1)
 	{
@@ -107,28 +150,32 @@ main (int argc, char *argv[])
 	{
 	  a[i] = rand () % size;
 	}
+      // Checksum of the input, for the result check
+      struct sort_sum in = { 0, 0 };
+      int validate = sort_validate_enabled ();
+      if (validate)
+	in = sort_checksum (a, size);
       // Sort with root process
       double start = get_time ();
       run_root_mpi (a, size, temp, max_rank, tag, MPI_COMM_WORLD, threads);
       double end = get_time ();
-      printf ("Start = %.2f\nEnd = %.2f\nElapsed = %.2f\n",
+      INSTR_RECORD (INSTR_TOTAL, start, end, size * sizeof (int));
+      affinity_release ();
+      printf ("Start = %.2f\nEnd = %.2f\nElapsed = %.6f\n",
 	      start, end, end - start);
       // Result check
-      for (i = 1; i < size; i++)
-	{
-	  if (!(a[i - 1] <= a[i]))
-	    {
-	      printf ("Implementation error: a[%d]=%d > a[%d]=%d\n", i - 1,
-		      a[i - 1], i, a[i]);
-	      MPI_Abort (MPI_COMM_WORLD, 1);
-	    }
-	}
+      if (validate && !sort_validate (a, size, &in))
+	MPI_Abort (MPI_COMM_WORLD, 1);
     }				// Root process end
   else
     {				// Node processes  
       run_node_mpi (my_rank, max_rank, tag, MPI_COMM_WORLD, threads);
     }
   fflush (stdout);
+  INSTR_REPORT_MPI ("hybrid_mergesort", size, MPI_COMM_WORLD);
+  if (n_streams > 1)
+    for (int i = 0; i < n_streams; i++)
+      MPI_Comm_free (&stream_comm[i]);
   MPI_Finalize ();
   return 0;
 }
@@ -155,17 +202,53 @@ run_root_mpi (int a[], int size, int temp[], int max_rank, int tag,
 void
 run_node_mpi (int my_rank, int max_rank, int tag, MPI_Comm comm, int threads)
 {
+  int level = topmost_level_mpi (my_rank);
   // Probe for a message and determine its size and sender
   MPI_Status status;
   int size;
-  MPI_Probe (MPI_ANY_SOURCE, tag, comm, &status);
+  MPI_Probe (MPI_ANY_SOURCE, tag, n_streams > 1 ? stream_comm[0] : comm,
+	     &status);
   MPI_Get_count (&status, MPI_INT, &size);
   int parent_rank = status.MPI_SOURCE;
+  if (n_streams > 1)
+    {
+      // Segment 0 came on stream 0; the others follow on theirs.
+      for (int i = 1; i < n_streams; i++)
+	{
+	  int count;
+	  MPI_Probe (parent_rank, tag, stream_comm[i], &status);
+	  MPI_Get_count (&status, MPI_INT, &count);
+	  size += count;
+	}
+    }
   // Allocate int a[size], temp[size] 
   int *a = malloc (sizeof (int) * size);
+  int *temp = malloc (sizeof (int) * size);
+  if (n_streams > 1)
+    {
+      INSTR_START (t_recv);
+      recv_streams (a, size, parent_rank, tag, threads);
+      INSTR_STOP (t_recv, INSTR_RECV, size * sizeof (int));
+      mergesort_parallel_mpi (a, size, temp, level, my_rank, max_rank, tag,
+			      comm, threads);
+      INSTR_START (t_send);
+      send_streams (a, size, parent_rank, tag, threads);
+      INSTR_STOP (t_send, INSTR_SEND, size * sizeof (int));
+      return;
+    }
+  INSTR_START (t_recv);
+  double recv_start = get_time ();
   MPI_Recv (a, size, MPI_INT, parent_rank, tag, comm, &status);
+  // Bandwidth of the link to the parent, to judge whether packing the
+  // sorted array pays
+  double bandwidth = size * sizeof (int) / (get_time () - recv_start);
+  INSTR_STOP (t_recv, INSTR_RECV, size * sizeof (int));
+  mergesort_parallel_mpi (a, size, temp, level, my_rank, max_rank, tag, comm,
+			  threads);
   // Send sorted array to parent process
-  MPI_Send (a, size, MPI_INT, parent_rank, tag, comm);
+  INSTR_START (t_send);
+  pack_send_mpi (a, size, parent_rank, tag, comm, bandwidth);
+  INSTR_STOP (t_send, INSTR_SEND, size * sizeof (int));
   return;
 }
 
@@ -192,13 +275,55 @@ mergesort_parallel_mpi (int a[], int size, int temp[],
       mergesort_parallel_omp (a, size, temp, threads);
       // Was: mergesort_serial(a, size, temp);
     }
+  else if (n_streams > 1)
+    {
+      INSTR_START (t_sort);
+      int half = size / 2;
+      MPI_Request request[MAX_STREAMS];
+      // Send second half, a segment per stream, asynchronous
+      INSTR_START (t_isend);
+      for (int i = 0; i < n_streams; i++)
+	{
+	  int lo = STREAM_OFFSET (size - half, i);
+	  int hi = STREAM_OFFSET (size - half, i + 1);
+	  MPI_Isend (a + half + lo, hi - lo, MPI_INT, helper_rank, tag,
+		     stream_comm[i], &request[i]);
+	}
+      INSTR_STOP (t_isend, INSTR_ISEND, (size - half) * sizeof (int));
+      // Sort first half, while other threads receive the second
+      // half sorted, into the half of temp that the sort leaves free
+      int first = affinity_worker ();
+#pragma omp parallel sections num_threads (2)
+      {
+#pragma omp section
+	{
+	  affinity_enter (first);
+	  mergesort_parallel_mpi (a, half, temp, level + 1, my_rank,
+				  max_rank, tag, comm, threads);
+	}
+#pragma omp section
+	{
+	  INSTR_START (t_recv);
+	  recv_streams (temp + half, size - half, helper_rank, tag, threads);
+	  INSTR_STOP (t_recv, INSTR_RECV, (size - half) * sizeof (int));
+	}
+      }
+      MPI_Waitall (n_streams, request, MPI_STATUSES_IGNORE);
+      memcpy (a + half, temp + half, (size - half) * sizeof (int));
+      INSTR_START (t_merge);
+      merge_parallel_omp (a, size, temp, threads);
+      INSTR_STOP_MERGE (t_merge, size);
+      INSTR_STOP (t_sort, INSTR_SORT, size * sizeof (int));
+    }
   else
     {
+      INSTR_START (t_sort);
       MPI_Request request;
-      MPI_Status status;
       // Send second half, asynchronous
+      INSTR_START (t_isend);
       MPI_Isend (a + size / 2, size - size / 2, MPI_INT, helper_rank, tag,
 		 comm, &request);
+      INSTR_STOP (t_isend, INSTR_ISEND, (size - size / 2) * sizeof (int));
       // Sort first half with OpenMP
       // mergesort_parallel_omp(a, size/2, temp, threads);
       mergesort_parallel_mpi (a, size / 2, temp, level + 1, my_rank, max_rank,
@@ -206,14 +331,44 @@ mergesort_parallel_mpi (int a[], int size, int temp[],
       // Free the async request (matching receive will complete the transfer).
       MPI_Request_free (&request);
       // Receive second half sorted
-      MPI_Recv (a + size / 2, size - size / 2, MPI_INT, helper_rank, tag,
-		comm, &status);
+      INSTR_START (t_recv);
+      pack_recv_mpi (a + size / 2, size - size / 2, helper_rank, tag, comm);
+      INSTR_STOP (t_recv, INSTR_RECV, (size - size / 2) * sizeof (int));
       // Merge the two sorted sub-arrays through temp
-      merge (a, size, temp);
+      INSTR_START (t_merge);
+      merge_parallel_omp (a, size, temp, threads);
+      INSTR_STOP_MERGE (t_merge, size);
+      INSTR_STOP (t_sort, INSTR_SORT, size * sizeof (int));
     }
   return;
 }
 
+// Send the SIZE keys of A to DEST, each segment on its stream, from
+// THREADS OpenMP threads at once.
+void
+send_streams (const int a[], int size, int dest, int tag, int threads)
+{
+#pragma omp parallel for num_threads (threads) schedule (static, 1)
+  for (int i = 0; i < n_streams; i++)
+    {
+      int lo = STREAM_OFFSET (size, i), hi = STREAM_OFFSET (size, i + 1);
+      MPI_Send (a + lo, hi - lo, MPI_INT, dest, tag, stream_comm[i]);
+    }
+}
+
+// Receive the SIZE keys sent by send_streams from SOURCE into A.
+void
+recv_streams (int a[], int size, int source, int tag, int threads)
+{
+#pragma omp parallel for num_threads (threads) schedule (static, 1)
+  for (int i = 0; i < n_streams; i++)
+    {
+      int lo = STREAM_OFFSET (size, i), hi = STREAM_OFFSET (size, i + 1);
+      MPI_Recv (a + lo, hi - lo, MPI_INT, source, tag, stream_comm[i],
+		MPI_STATUS_IGNORE);
+    }
+}
+
 // OpenMP merge sort with given number of threads
 void
 mergesort_parallel_omp (int a[], int size, int temp[], int threads)
@@ -221,22 +376,41 @@ mergesort_parallel_omp (int a[], int size, int temp[], int threads)
   if (threads == 1)
     {
       //printf("Thread %d begins serial mergesort\n", omp_get_thread_num());
+      INSTR_START (t_leaf);
       mergesort_serial (a, size, temp);
+      INSTR_STOP (t_leaf, INSTR_LEAF_SORT, size * sizeof (int));
     }
   else if (threads > 1)
     {
+      // Workers first to first + threads - 1 of the process
+      int first = affinity_worker ();
+      INSTR_START (t_sort);
+      INSTR_DECLARE (t_left_done);
+      INSTR_DECLARE (t_right_done);
 #pragma omp parallel sections
       {
 #pragma omp section
-	mergesort_parallel_omp (a, size / 2, temp, threads / 2);
+	{
+	  affinity_enter (first);
+	  mergesort_parallel_omp (a, size / 2, temp, threads / 2);
+	  INSTR_STAMP (t_left_done);
+	}
 #pragma omp section
-	mergesort_parallel_omp (a + size / 2, size - size / 2,
-	                        temp + size / 2, threads - threads / 2);
+	{
+	  affinity_enter (first + threads / 2);
+	  mergesort_parallel_omp (a + size / 2, size - size / 2,
+				  temp + size / 2, threads - threads / 2);
+	  INSTR_STAMP (t_right_done);
+	}
       }
+      INSTR_JOIN_WAIT (t_left_done, t_right_done);
       // Thread allocation is implementation dependent
       // Some threads can execute multiple sections while others are idle 
       // Merge the two sorted sub-arrays through temp
-      merge (a, size, temp);
+      INSTR_START (t_merge);
+      merge_parallel_omp (a, size, temp, threads);
+      INSTR_STOP_MERGE (t_merge, size);
+      INSTR_STOP (t_sort, INSTR_SORT, size * sizeof (int));
     }
   else
     {
@@ -249,7 +423,7 @@ void
 mergesort_serial (int a[], int size, int temp[])
 {
   // Switch to insertion sort for small arrays
-  if (size <= SMALL)
+  if (size <= sort_tune.small)
     {
       insertion_sort (a, size);
       return;
@@ -296,6 +470,55 @@ merge (int a[], int size, int temp[])
   memcpy (a, temp, size * sizeof (int));
 }
 
+// The number of elements of X among the first K of the merge of X[0
+// .. M - 1] and Y[0 .. N - 1], which takes X first on ties
+static int
+co_rank (int k, const int x[], int m, const int y[], int n)
+{
+  int lo = k > n ? k - n : 0, hi = k < m ? k : m;
+  while (lo < hi)
+    {
+      int i = lo + (hi - lo) / 2;
+      if (x[i] <= y[k - i - 1])
+	lo = i + 1;
+      else
+	hi = i;
+    }
+  return lo;
+}
+
+// Merge the sorted halves of A through TEMP, as merge does, with
+// THREADS OpenMP threads.  Each thread merges the part of the output
+// that it splits off by co-ranking, and copies it back.
+void
+merge_parallel_omp (int a[], int size, int temp[], int threads)
+{
+  if (threads <= 1 || size < MERGE_SPLIT_MIN)
+    {
+      merge (a, size, temp);
+      return;
+    }
+  int left_size = size / 2, right_size = size - size / 2;
+  int first = affinity_worker ();
+#pragma omp parallel num_threads (threads)
+  {
+    int t = omp_get_thread_num (), n = omp_get_num_threads ();
+    affinity_enter (first + t);
+    int k0 = (long) size * t / n, k1 = (long) size * (t + 1) / n;
+    int i0 = co_rank (k0, a, left_size, a + left_size, right_size);
+    int i1 = co_rank (k1, a, left_size, a + left_size, right_size);
+    int *x = a + i0, *x_end = a + i1;
+    int *y = a + left_size + k0 - i0, *y_end = a + left_size + k1 - i1;
+    int *out = temp + k0;
+    while (x < x_end && y < y_end)
+      *out++ = *y < *x ? *y++ : *x++;
+    memcpy (out, x, (x_end - x) * sizeof (int));
+    memcpy (out + (x_end - x), y, (y_end - y) * sizeof (int));
+#pragma omp barrier
+    memcpy (a + k0, temp + k0, (k1 - k0) * sizeof (int));
+  }
+}
+
 void
 insertion_sort (int a[], int size)
 {
@@ -0,0 +1,267 @@
+/* Per-phase instrumentation for the merge sort drivers.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "instrument.h"
+
+// Upper bound on the number of distinct threads that may record
+// events during one run (nested OpenMP teams included).
+#define INSTR_MAX_THREADS 1024
+
+static const char *const instr_slot_name[INSTR_MERGE] = {
+  "total", "sort", "leaf_sort", "barrier", "isend", "send", "recv",
+  "get", "put", "memget", "memput"
+};
+
+const char *
+instr_name (int slot)
+{
+  return slot < INSTR_MERGE ? instr_slot_name[slot] : "merge";
+}
+
+#ifdef SORT_STATS
+static double *instr_table[INSTR_MAX_THREADS];
+static int instr_n_threads;
+static __thread double *instr_self;
+
+// Allocate, and register, the calling thread's counters.
+static double *
+instr_thread_counters (void)
+{
+  int id = __atomic_fetch_add (&instr_n_threads, 1, __ATOMIC_RELAXED);
+  if (id >= INSTR_MAX_THREADS)
+    {
+      fprintf (stderr, "Error: more than %d instrumented threads\n",
+	       INSTR_MAX_THREADS);
+      abort ();
+    }
+  double *counters = calloc (INSTR_N_VALUES, sizeof (double));
+  if (counters == NULL)
+    {
+      perror ("instr_thread_counters");
+      abort ();
+    }
+  __atomic_store_n (&instr_table[id], counters, __ATOMIC_RELEASE);
+  instr_self = counters;
+  return counters;
+}
+#endif /* SORT_STATS */
+
+// Record the interval [T0, T1] spent in SLOT, moving BYTES bytes.
+void
+instr_interval (int slot, double t0, double t1, double bytes)
+{
+#ifdef SORT_STATS
+  double *counters = instr_self ? instr_self : instr_thread_counters ();
+  double *v = counters + slot * INSTR_N_FIELDS;
+  v[INSTR_COUNT] += 1.0;
+  v[INSTR_BYTES] += bytes;
+  v[INSTR_SECONDS] += t1 - t0;
+#endif
+#ifdef SORT_TRACE
+  trace_record (slot, t0, t1, bytes);
+#endif
+}
+
+#ifdef SORT_PERF
+// Counters are read outside of the time stamps on both ends,
+// so that the cost of reading them is not timed.
+void
+instr_mark_start (struct instr_mark *mark)
+{
+  perf_read (mark->counter);
+  mark->time = get_time ();
+}
+
+void
+instr_mark_stop (const struct instr_mark *mark, int slot, double bytes)
+{
+  double t1 = get_time ();
+  double counter[PERF_N_EVENTS];
+  perf_read (counter);
+  instr_interval (slot, mark->time, t1, bytes);
+  double *v = instr_self + slot * INSTR_N_FIELDS + INSTR_PERF;
+  for (int event = 0; event < PERF_N_EVENTS; event++)
+    v[event] += counter[event] - mark->counter[event];
+}
+#endif /* SORT_PERF */
+
+#ifdef SORT_STATS
+// Sum this process's counters over its threads into SUM, and
+// record the largest per-thread value of each counter in MAX.
+// Returns the number of threads that recorded events.
+int
+instr_collect (double sum[], double max[])
+{
+  int n_threads = __atomic_load_n (&instr_n_threads, __ATOMIC_ACQUIRE);
+  memset (sum, 0, INSTR_N_VALUES * sizeof (double));
+  memset (max, 0, INSTR_N_VALUES * sizeof (double));
+  for (int t = 0; t < n_threads; t++)
+    {
+      const double *v = __atomic_load_n (&instr_table[t], __ATOMIC_ACQUIRE);
+      if (v == NULL)
+	continue;
+      for (int i = 0; i < INSTR_N_VALUES; i++)
+	{
+	  sum[i] += v[i];
+	  if (v[i] > max[i])
+	    max[i] = v[i];
+	}
+    }
+  return n_threads;
+}
+#endif /* SORT_STATS */
+
+void
+instr_combine (double sum[], double max[],
+	       const double other_sum[], const double other_max[])
+{
+  for (int i = 0; i < INSTR_N_VALUES; i++)
+    {
+      sum[i] += other_sum[i];
+      if (other_max[i] > max[i])
+	max[i] = other_max[i];
+    }
+}
+
+#ifdef SORT_PERF
+// Counters and derived metrics of the summed fields V, over ELEMENTS
+// elements.  Seconds are summed over threads, so GB/s is per thread.
+static void
+instr_write_counters (FILE * f, const double v[], double elements)
+{
+  const double *c = v + INSTR_PERF;
+  for (int event = 0; event < PERF_N_EVENTS; event++)
+    if (perf_available (event))
+      fprintf (f, ",\"%s\":%.0f", perf_event_name[event], c[event]);
+    else
+      fprintf (f, ",\"%s\":null", perf_event_name[event]);
+  if (perf_available (PERF_CYCLES) && perf_available (PERF_INSTRUCTIONS)
+      && c[PERF_CYCLES] > 0.0)
+    fprintf (f, ",\"ipc\":%.3f", c[PERF_INSTRUCTIONS] / c[PERF_CYCLES]);
+  for (int event = PERF_BRANCH_MISSES; event < PERF_N_EVENTS; event++)
+    if (perf_available (event) && elements > 0.0)
+      fprintf (f, ",\"%s_per_element\":%.4f", perf_event_name[event],
+	       c[event] / elements);
+  if (v[INSTR_SECONDS] > 0.0)
+    fprintf (f, ",\"gb_per_s\":%.3f",
+	     v[INSTR_BYTES] / v[INSTR_SECONDS] * 1.0e-9);
+}
+#endif
+
+static void
+instr_write_slot (FILE * f, const double sum[], const double max[], int slot)
+{
+  const double *s = sum + slot * INSTR_N_FIELDS;
+  const double *m = max + slot * INSTR_N_FIELDS;
+  fprintf (f, "\"count\":%.0f,\"bytes\":%.0f,"
+	   "\"seconds\":%.6f,\"max_seconds\":%.6f",
+	   s[INSTR_COUNT], s[INSTR_BYTES], s[INSTR_SECONDS],
+	   m[INSTR_SECONDS]);
+#ifdef SORT_PERF
+  // Totals and barrier waits are recorded without counters.
+  if (slot != INSTR_TOTAL && slot != INSTR_BARRIER)
+    instr_write_counters (f, s, s[INSTR_BYTES] / sizeof (int));
+#endif
+}
+
+// Write the reduced counters as one JSON object on a single line.
+// Slots that recorded no events are omitted.
+void
+instr_write_json (FILE * f, const char *variant, long size,
+		  int ranks, int threads,
+		  const double sum[], const double max[])
+{
+  fprintf (f, "Stats = {\"variant\":\"%s\",\"size\":%ld,"
+	   "\"ranks\":%d,\"threads\":%d,\"phases\":{",
+	   variant, size, ranks, threads);
+  const char *sep = "";
+  for (int slot = 0; slot < INSTR_MERGE; slot++)
+    {
+      if (sum[slot * INSTR_N_FIELDS + INSTR_COUNT] == 0.0)
+	continue;
+      fprintf (f, "%s\"%s\":{", sep, instr_slot_name[slot]);
+      instr_write_slot (f, sum, max, slot);
+      fputc ('}', f);
+      sep = ",";
+    }
+  fputs ("},\"merge_levels\":[", f);
+  sep = "";
+  for (int slot = INSTR_MERGE; slot < INSTR_N_SLOTS; slot++)
+    {
+      if (sum[slot * INSTR_N_FIELDS + INSTR_COUNT] == 0.0)
+	continue;
+      fprintf (f, "%s{\"log2_size\":%d,", sep, slot - INSTR_MERGE);
+      instr_write_slot (f, sum, max, slot);
+      fputc ('}', f);
+      sep = ",";
+    }
+  fputc (']', f);
+#ifdef SORT_PERF
+  // The leaf sorts and merges together: the work of the sort proper,
+  // without communication and waiting.
+  double compute[INSTR_N_FIELDS];
+  memset (compute, 0, sizeof (compute));
+  for (int slot = INSTR_LEAF_SORT; slot < INSTR_N_SLOTS; slot++)
+    if (slot == INSTR_LEAF_SORT || slot >= INSTR_MERGE)
+      for (int i = 0; i < INSTR_N_FIELDS; i++)
+	compute[i] += sum[slot * INSTR_N_FIELDS + i];
+  // Misses are per element sorted, each of which the leaf sorts
+  // see once; GB/s counts the bytes of all passes.
+  double n = sum[INSTR_LEAF_SORT * INSTR_N_FIELDS + INSTR_BYTES]
+    / sizeof (int);
+  fprintf (f, ",\"compute\":{\"seconds\":%.6f,\"bytes\":%.0f",
+	   compute[INSTR_SECONDS], compute[INSTR_BYTES]);
+  instr_write_counters (f, compute, n);
+  fputc ('}', f);
+#endif
+  fputs ("}\n", f);
+#ifdef SORT_PERF
+  // The same, on one line, for perf-test.
+  const double *c = compute + INSTR_PERF;
+  fprintf (f, "Counters = ipc=%.2f branch_misses/elem=%.3f "
+	   "llc_misses/elem=%.4f dtlb_misses/elem=%.4f GB/s=%.2f\n",
+	   c[PERF_CYCLES] > 0.0 ? c[PERF_INSTRUCTIONS] / c[PERF_CYCLES] : 0.0,
+	   n > 0.0 ? c[PERF_BRANCH_MISSES] / n : 0.0,
+	   n > 0.0 ? c[PERF_LLC_MISSES] / n : 0.0,
+	   n > 0.0 ? c[PERF_DTLB_MISSES] / n : 0.0,
+	   compute[INSTR_SECONDS] > 0.0
+	   ? compute[INSTR_BYTES] / compute[INSTR_SECONDS] * 1.0e-9 : 0.0);
+#endif
+}
+
+// Shared memory (serial and OpenMP) drivers.
+void
+instr_report (const char *variant, long size)
+{
+#ifdef SORT_STATS
+  double sum[INSTR_N_VALUES], max[INSTR_N_VALUES];
+  int threads = instr_collect (sum, max);
+  instr_write_json (stdout, variant, size, 1, threads, sum, max);
+  fflush (stdout);
+#endif
+#ifdef SORT_TRACE
+  trace_set_clock (0.0, trace_start_time ());
+  trace_write_fragment (0);
+  trace_merge_fragments (1);
+#endif
+}
@@ -0,0 +1,241 @@
+/* Per-phase instrumentation for the merge sort drivers.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+// Instrumentation is compiled in only when SORT_STATS (make STATS=1)
+// or SORT_TRACE (make TRACE=1) is defined.  Otherwise, every INSTR_*
+// macro below expands to nothing and instrument.o is not linked.
+//
+// SORT_STATS: each thread (OpenMP or otherwise) accumulates a count,
+// a byte count and elapsed seconds per slot.  At exit, the counters
+// are summed over threads and ranks, and the per-thread maximum time
+// is kept, which exposes load imbalance.  The result is written
+// as a single line on stdout:  "Stats = { ... }" (JSON).
+//
+// SORT_TRACE: each instrumented interval is also recorded as an
+// event in a per-thread ring buffer, and the events of all threads
+// and ranks are written at exit as a Chrome/Perfetto trace (see trace.h).
+//
+// SORT_PERF: INSTR_START/INSTR_STOP intervals also accumulate
+// hardware performance counters (see perf_counters.h).
+
+#include "perf_counters.h"
+
+enum instr_slot
+{
+  INSTR_TOTAL,			// The timed region, as seen by the driver
+  INSTR_SORT,			// Recursive parallel sort (inclusive)
+  INSTR_LEAF_SORT,		// Serial sort at the leaves of the parallel tree
+  INSTR_BARRIER,		// Barrier, or OpenMP join, wait
+  INSTR_ISEND,
+  INSTR_SEND,
+  INSTR_RECV,
+  INSTR_GET,
+  INSTR_PUT,
+  INSTR_MEMGET,
+  INSTR_MEMPUT,
+  INSTR_MERGE,			// Merges, one slot per log2 (merge size)
+  INSTR_N_SLOTS = INSTR_MERGE + 32
+};
+
+enum instr_field
+{
+  INSTR_COUNT,
+  INSTR_BYTES,
+  INSTR_SECONDS,
+  INSTR_PERF,			// PERF_N_EVENTS counters, if any
+  INSTR_N_FIELDS = INSTR_PERF + PERF_N_EVENTS
+};
+
+#define INSTR_N_VALUES (INSTR_N_SLOTS * INSTR_N_FIELDS)
+
+#if defined (SORT_STATS) || defined (SORT_TRACE)
+
+#include <stdio.h>
+#include "trace.h"
+
+extern double get_time (void);
+extern const char *instr_name (int slot);
+extern void instr_interval (int slot, double t0, double t1, double bytes);
+extern int instr_collect (double sum[], double max[]);
+extern void instr_combine (double sum[], double max[],
+			   const double other_sum[],
+			   const double other_max[]);
+extern void instr_write_json (FILE * f, const char *variant, long size,
+			      int ranks, int threads,
+			      const double sum[], const double max[]);
+extern void instr_report (const char *variant, long size);
+
+// Merges are bucketed by the log2 of the number of elements merged,
+// which numbers the merge levels of a run from the leaves upward.
+static inline int
+instr_merge_slot (long size)
+{
+  return INSTR_MERGE + (size > 1 ? 63 - __builtin_clzl (size) : 0);
+}
+
+#ifdef SORT_PERF
+struct instr_mark
+{
+  double time;
+  double counter[PERF_N_EVENTS];
+};
+
+extern void instr_mark_start (struct instr_mark *mark);
+extern void instr_mark_stop (const struct instr_mark *mark,
+			     int slot, double bytes);
+
+#define INSTR_START(t)		struct instr_mark t; instr_mark_start (&(t))
+#define INSTR_STOP(t, slot, bytes) \
+  instr_mark_stop (&(t), (slot), (double) (bytes))
+#define INSTR_STOP_MERGE(t, size) \
+  instr_mark_stop (&(t), instr_merge_slot (size), \
+		   (double) (size) * sizeof (int))
+#else
+#define INSTR_START(t)		double t = get_time ()
+#define INSTR_STOP(t, slot, bytes) \
+  instr_interval ((slot), (t), get_time (), (double) (bytes))
+#define INSTR_STOP_MERGE(t, size) \
+  instr_interval (instr_merge_slot (size), (t), get_time (), \
+		  (double) (size) * sizeof (int))
+#endif
+#define INSTR_RECORD(slot, t0, t1, bytes) \
+  instr_interval ((slot), (t0), (t1), (double) (bytes))
+// OpenMP join: each section stamps its finish time; the thread that
+// finished first waits for the other.
+#define INSTR_DECLARE(t)	double t = 0.0
+#define INSTR_STAMP(t)		((t) = get_time ())
+#define INSTR_JOIN_WAIT(t1, t2) \
+  instr_interval (INSTR_BARRIER, (t1) < (t2) ? (t1) : (t2), \
+		  (t1) > (t2) ? (t1) : (t2), 0.0)
+#define INSTR_REPORT(variant, size)	instr_report ((variant), (size))
+
+#ifdef MPI_VERSION
+// Collective over COMM; rank 0 writes the summary.
+static inline void
+instr_report_mpi (const char *variant, long size, MPI_Comm comm)
+{
+  int rank, ranks;
+  MPI_Comm_rank (comm, &rank);
+  MPI_Comm_size (comm, &ranks);
+#ifdef SORT_STATS
+  double sum[INSTR_N_VALUES], max[INSTR_N_VALUES];
+  double all_sum[INSTR_N_VALUES], all_max[INSTR_N_VALUES];
+  int threads, all_threads;
+  threads = instr_collect (sum, max);
+  MPI_Reduce (sum, all_sum, INSTR_N_VALUES, MPI_DOUBLE, MPI_SUM, 0, comm);
+  MPI_Reduce (max, all_max, INSTR_N_VALUES, MPI_DOUBLE, MPI_MAX, 0, comm);
+  MPI_Reduce (&threads, &all_threads, 1, MPI_INT, MPI_SUM, 0, comm);
+  if (!rank)
+    {
+      instr_write_json (stdout, variant, size, ranks, all_threads,
+			all_sum, all_max);
+      fflush (stdout);
+    }
+#endif
+#ifdef SORT_TRACE
+  trace_sync_clock_mpi (comm);
+  trace_write_fragment (rank);
+  MPI_Barrier (comm);
+  if (!rank)
+    trace_merge_fragments (ranks);
+#endif
+}
+
+#define INSTR_REPORT_MPI(variant, size, comm) \
+  instr_report_mpi ((variant), (size), (comm))
+#endif /* MPI_VERSION */
+
+#ifdef __UPC__
+#ifdef SORT_TRACE
+static shared double instr_trace_base;
+#endif
+
+// Collective over all UPC threads; thread 0 writes the summary.
+static inline void
+instr_report_upc (const char *variant, long size)
+{
+#ifdef SORT_STATS
+  shared [INSTR_N_VALUES + 1] double *all_sum
+    = upc_all_alloc (THREADS, (INSTR_N_VALUES + 1) * sizeof (double));
+  shared [INSTR_N_VALUES + 1] double *all_max
+    = upc_all_alloc (THREADS, (INSTR_N_VALUES + 1) * sizeof (double));
+  double sum[INSTR_N_VALUES + 1], max[INSTR_N_VALUES + 1];
+  // The OpenMP thread count travels in the extra trailing value.
+  sum[INSTR_N_VALUES] = max[INSTR_N_VALUES] = instr_collect (sum, max);
+  upc_memput (&all_sum[MYTHREAD * (INSTR_N_VALUES + 1)], sum, sizeof (sum));
+  upc_memput (&all_max[MYTHREAD * (INSTR_N_VALUES + 1)], max, sizeof (max));
+  upc_barrier;
+  if (!MYTHREAD)
+    {
+      double other_sum[INSTR_N_VALUES + 1], other_max[INSTR_N_VALUES + 1];
+      for (int t = 1; t < THREADS; t++)
+	{
+	  upc_memget (other_sum, &all_sum[t * (INSTR_N_VALUES + 1)],
+		      sizeof (other_sum));
+	  upc_memget (other_max, &all_max[t * (INSTR_N_VALUES + 1)],
+		      sizeof (other_max));
+	  instr_combine (sum, max, other_sum, other_max);
+	  sum[INSTR_N_VALUES] += other_sum[INSTR_N_VALUES];
+	}
+      instr_write_json (stdout, variant, size, THREADS,
+			(int) sum[INSTR_N_VALUES], sum, max);
+      fflush (stdout);
+      upc_free (all_sum);
+      upc_free (all_max);
+    }
+  upc_barrier;
+#endif
+#ifdef SORT_TRACE
+  // GUPC's SMP runtime runs all UPC threads on one node, whose
+  // monotonic clock is common to all of them.  Only the time
+  // origin of the trace is taken from thread 0.
+  if (!MYTHREAD)
+    instr_trace_base = trace_start_time ();
+  upc_barrier;
+  trace_set_clock (0.0, instr_trace_base);
+  trace_write_fragment (MYTHREAD);
+  upc_barrier;
+  if (!MYTHREAD)
+    trace_merge_fragments (THREADS);
+#endif
+}
+
+#define INSTR_REPORT_UPC(variant, size)	instr_report_upc ((variant), (size))
+#endif /* __UPC__ */
+
+#else /* !SORT_STATS && !SORT_TRACE */
+
+#define INSTR_START(t)				((void) 0)
+#define INSTR_STOP(t, slot, bytes)		((void) 0)
+#define INSTR_STOP_MERGE(t, size)		((void) 0)
+#define INSTR_RECORD(slot, t0, t1, bytes)	((void) 0)
+#define INSTR_DECLARE(t)			((void) 0)
+#define INSTR_STAMP(t)				((void) 0)
+#define INSTR_JOIN_WAIT(t1, t2)			((void) 0)
+#define INSTR_REPORT(variant, size)		((void) 0)
+#define INSTR_REPORT_MPI(variant, size, comm)	((void) 0)
+#define INSTR_REPORT_UPC(variant, size)		((void) 0)
+
+#endif /* SORT_STATS || SORT_TRACE */
+
+#endif /* INSTRUMENT_H */
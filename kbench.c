@@ -0,0 +1,451 @@
+/* Microbenchmarks of the merge sort kernels.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+// Times each kernel on its own, single threaded, over array sizes
+// from the L1 cache to DRAM, and reports nanoseconds per element,
+// GB/s and bytes per cycle, where bytes are the size * sizeof (int)
+// bytes of the array that one call processes.
+//
+// Each kernel call is preceded by a copy of its input into place;
+// batches of calls are timed with and without the kernel, and the
+// difference is divided by the number of calls.  The best of
+// several batches is reported.
+//
+// merge_rma is the kernel of mpi_rma_nc_mergesort.c, on an MPI
+// window over this process's memory, so it measures the MPI
+// library's per-element RMA overhead without any network.
+// merge_upc stands in for the kernel of upc_no_copy_mergesort.upc,
+// which is not compiled here: each element access goes through an
+// out-of-line call, as GUPC's runtime does for a pointer-to-shared
+// with local affinity.
+//
+// Cycles are reference (TSC) cycles, calibrated against get_time,
+// and are reported only on x86.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <mpi.h>
+#include "msort.h"
+#include "sort_input.h"
+
+#if defined (__x86_64__) || defined (__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+#define MAX_SIZES 64
+#define N_BATCHES 5
+
+extern double get_time (void);
+
+enum kernel
+{
+  K_MEMCPY,
+  K_INSERTION_SORT,
+  K_MERGE,
+  K_MERGE_GALLOP,
+  K_MERGESORT_SERIAL,
+  K_MERGE_RMA,
+  K_MERGE_UPC,
+  N_KERNELS
+};
+
+static const struct
+{
+  const char *name;
+  int max_size;			// Larger sizes take too long
+} kernel_table[N_KERNELS] = {
+  {"memcpy", 0},
+  {"insertion_sort", 16384},
+  {"merge", 0},
+  {"merge_gallop", 0},
+  {"mergesort_serial", 0},
+  {"merge_rma", 1 << 18},
+  {"merge_upc", 0},
+};
+
+// The merge_rma window; rank 0 is this process.
+static MPI_Win win;
+
+void merge_rma (int a_offset, int size, int left_size, int temp[]);
+void merge_upc (int a[], int size, int left_size, int temp[]);
+
+void
+merge_rma (int a_offset, int size, int left_size, int temp[])
+{
+  int i1 = 0;
+  int i2 = left_size;
+  int tempi = 0;
+  int a_i1, a_i2;
+  while (i1 < left_size && i2 < size)
+    {
+      MPI_Get_accumulate (NULL, 0, MPI_DATATYPE_NULL,
+			  &a_i1, 1, MPI_INT,
+			  0, a_offset + i1, 1, MPI_INT, MPI_NO_OP, win);
+      MPI_Get_accumulate (NULL, 0, MPI_DATATYPE_NULL,
+			  &a_i2, 1, MPI_INT,
+			  0, a_offset + i2, 1, MPI_INT, MPI_NO_OP, win);
+      MPI_Win_flush_local (0, win);
+      if (a_i1 < a_i2)
+	{
+	  temp[tempi] = a_i1;
+	  i1++;
+	}
+      else
+	{
+	  temp[tempi] = a_i2;
+	  i2++;
+	}
+      tempi++;
+    }
+  while (i1 < left_size)
+    {
+      MPI_Get_accumulate (NULL, 0, MPI_DATATYPE_NULL,
+			  &a_i1, 1, MPI_INT,
+			  0, a_offset + i1, 1, MPI_INT, MPI_NO_OP, win);
+      MPI_Win_flush_local (0, win);
+      temp[tempi] = a_i1;
+      i1++;
+      tempi++;
+    }
+  while (i2 < size)
+    {
+      MPI_Get_accumulate (NULL, 0, MPI_DATATYPE_NULL,
+			  &a_i2, 1, MPI_INT,
+			  0, a_offset + i2, 1, MPI_INT, MPI_NO_OP, win);
+      MPI_Win_flush_local (0, win);
+      temp[tempi] = a_i2;
+      i2++;
+      tempi++;
+    }
+  // Copy sorted temp array into main array, a
+  MPI_Put (temp, size, MPI_INT, 0, a_offset, size, MPI_INT, win);
+  MPI_Win_flush (0, win);
+}
+
+// Stand-ins for the UPC runtime's shared get and memput.
+struct shared_ptr
+{
+  int *base;
+  unsigned long thread, offset;
+};
+
+static int __attribute__ ((noinline))
+upc_get_int (struct shared_ptr p, long i)
+{
+  return *(volatile int *) (p.base + p.offset + i);
+}
+
+static void __attribute__ ((noinline))
+upc_memput_stand_in (struct shared_ptr p, const int *src, size_t n)
+{
+  memcpy (p.base + p.offset, src, n);
+}
+
+void
+merge_upc (int a_local[], int size, int left_size, int temp[])
+{
+  struct shared_ptr a = { a_local, 0, 0 };
+  int i1 = 0;
+  int i2 = left_size;
+  int tempi = 0;
+  while (i1 < left_size && i2 < size)
+    {
+      if (upc_get_int (a, i1) < upc_get_int (a, i2))
+	{
+	  temp[tempi] = upc_get_int (a, i1);
+	  i1++;
+	}
+      else
+	{
+	  temp[tempi] = upc_get_int (a, i2);
+	  i2++;
+	}
+      tempi++;
+    }
+  while (i1 < left_size)
+    {
+      temp[tempi] = upc_get_int (a, i1);
+      i1++;
+      tempi++;
+    }
+  while (i2 < size)
+    {
+      temp[tempi] = upc_get_int (a, i2);
+      i2++;
+      tempi++;
+    }
+  // Copy sorted temp array into main array, a
+  upc_memput_stand_in (a, temp, size * sizeof (int));
+}
+
+static double
+cycles_per_second (void)
+{
+#ifdef HAVE_TSC
+  double t0 = get_time (), t1;
+  unsigned long long c0 = __rdtsc (), c1;
+  do
+    t1 = get_time ();
+  while (t1 - t0 < 0.1);
+  c1 = __rdtsc ();
+  return (double) (c1 - c0) / (t1 - t0);
+#else
+  return 0.0;
+#endif
+}
+
+// Run CALLS calls of KERNEL, each after restoring A from SRC; the
+// kernel itself is skipped if !RUN.  Returns the elapsed time.
+static double
+batch (int kernel, int calls, int run, int a[], int temp[],
+       const int src[], int size)
+{
+  int i;
+  double start = get_time ();
+  for (i = 0; i < calls; i++)
+    {
+      if (kernel == K_MEMCPY)
+	{
+	  if (run)
+	    memcpy (a, src, size * sizeof (int));
+	  continue;
+	}
+      memcpy (a, src, size * sizeof (int));
+      if (kernel == K_MERGE_RMA)
+	MPI_Win_sync (win);
+      if (!run)
+	continue;
+      switch (kernel)
+	{
+	case K_INSERTION_SORT:
+	  insertion_sort (a, size);
+	  break;
+	case K_MERGE:
+	  merge (a, size, size / 2, temp);
+	  break;
+	case K_MERGE_GALLOP:
+	  merge_gallop (a, size, size / 2, temp);
+	  break;
+	case K_MERGESORT_SERIAL:
+	  mergesort_serial (a, size, temp);
+	  break;
+	case K_MERGE_RMA:
+	  merge_rma (0, size, size / 2, temp);
+	  MPI_Win_sync (win);
+	  break;
+	case K_MERGE_UPC:
+	  merge_upc (a, size, size / 2, temp);
+	  break;
+	}
+    }
+  return get_time () - start;
+}
+
+// Seconds per call of KERNEL on SIZE elements.
+static double
+time_kernel (int kernel, int size, double min_time)
+{
+  int *src = malloc (sizeof (int) * size);
+  int *temp = malloc (sizeof (int) * size);
+  int *a, i, calls;
+  double best = 0.0;
+  // merge_rma sorts the window's memory, allocated as the driver does.
+  if (kernel == K_MERGE_RMA)
+    {
+      MPI_Win_allocate (size * sizeof (int), sizeof (int), MPI_INFO_NULL,
+			MPI_COMM_SELF, &a, &win);
+      MPI_Win_lock_all (0, win);
+    }
+  else
+    a = malloc (sizeof (int) * size);
+  if (src == NULL || temp == NULL || a == NULL)
+    {
+      printf ("Error: Could not allocate array of size %d\n", size);
+      exit (1);
+    }
+  sort_input_fill (src, size, DIST_RANDOM);
+  // The merges take two sorted halves.
+  if (kernel == K_MERGE || kernel == K_MERGE_GALLOP || kernel == K_MERGE_RMA
+      || kernel == K_MERGE_UPC)
+    {
+      mergesort_serial (src, size / 2, temp);
+      mergesort_serial (src + size / 2, size - size / 2, temp);
+    }
+  // Size the batches to take MIN_TIME / N_BATCHES each.
+  for (calls = 1;
+       batch (kernel, calls, 1, a, temp, src, size) < min_time / N_BATCHES
+       && calls < (1 << 30); calls *= 2)
+    ;
+  for (i = 0; i < N_BATCHES; i++)
+    {
+      double with = batch (kernel, calls, 1, a, temp, src, size);
+      double without = batch (kernel, calls, 0, a, temp, src, size);
+      double t = (with - without) / calls;
+      if (i == 0 || t < best)
+	best = t;
+    }
+  if (kernel == K_MERGE_RMA)
+    {
+      MPI_Win_unlock_all (win);
+      MPI_Win_free (&win);
+    }
+  else
+    free (a);
+  free (src);
+  free (temp);
+  return best > 0.0 ? best : 0.0;
+}
+
+static void
+usage (const char *prog)
+{
+  int k;
+  printf ("Usage: %s [-k KERNELS] [-n SIZES] [-t SECONDS] [-o FILE]\n"
+	  "  -k KERNELS   comma separated kernels (default: all)\n"
+	  "  -n SIZES     comma separated array sizes (default: 1024 to"
+	  " 16M,\n"
+	  "               by factors of 4)\n"
+	  "  -t SECONDS   minimum time per measurement (default: 0.2)\n"
+	  "  -o FILE      also write the results to FILE, as CSV\n", prog);
+  printf ("Kernels:");
+  for (k = 0; k < N_KERNELS; k++)
+    printf (" %s", kernel_table[k].name);
+  printf ("\n");
+}
+
+int
+main (int argc, char *argv[])
+{
+  int selected[N_KERNELS], n_selected = 0;
+  int size[MAX_SIZES], n_sizes = 0;
+  double min_time = 0.2;
+  const char *csv_name = NULL;
+  char *item, *save;
+  int c, i, k;
+  MPI_Init (&argc, &argv);
+  while ((c = getopt (argc, argv, "k:n:t:o:h")) != -1)
+    {
+      int ok = 1;
+      switch (c)
+	{
+	case 'k':
+	  for (item = strtok_r (optarg, ",", &save); ok && item != NULL;
+	       item = strtok_r (NULL, ",", &save))
+	    {
+	      for (k = 0; k < N_KERNELS; k++)
+		if (strcmp (item, kernel_table[k].name) == 0)
+		  break;
+	      ok = k < N_KERNELS && n_selected < N_KERNELS;
+	      if (ok)
+		selected[n_selected++] = k;
+	    }
+	  break;
+	case 'n':
+	  for (item = strtok_r (optarg, ",", &save); ok && item != NULL;
+	       item = strtok_r (NULL, ",", &save))
+	    {
+	      ok = n_sizes < MAX_SIZES && atoi (item) >= 2;
+	      if (ok)
+		size[n_sizes++] = atoi (item);
+	    }
+	  break;
+	case 't':
+	  min_time = atof (optarg);
+	  ok = min_time > 0.0;
+	  break;
+	case 'o':
+	  csv_name = optarg;
+	  break;
+	default:
+	  ok = 0;
+	}
+      if (!ok)
+	break;
+      c = 0;
+    }
+  if (c != -1 || optind != argc)
+    {
+      usage (argv[0]);
+      MPI_Finalize ();
+      return 2;
+    }
+  if (n_selected == 0)
+    for (k = 0; k < N_KERNELS; k++)
+      selected[n_selected++] = k;
+  if (n_sizes == 0)
+    for (i = 1024; i <= 16 * 1024 * 1024; i *= 4)
+      size[n_sizes++] = i;
+
+  FILE *csv = NULL;
+  if (csv_name != NULL)
+    {
+      csv = fopen (csv_name, "w");
+      if (csv == NULL)
+	{
+	  perror (csv_name);
+	  MPI_Finalize ();
+	  return 1;
+	}
+      fprintf (csv, "kernel,n,bytes,ns_per_elem,gb_per_s,bytes_per_cycle\n");
+    }
+  double hz = cycles_per_second ();
+  if (hz > 0.0)
+    printf ("TSC = %.3f GHz\n", hz * 1.0e-9);
+  printf ("%-20s%12s%12s%12s%10s%12s\n", "kernel", "n", "bytes",
+	  "ns/elem", "GB/s", "bytes/cycle");
+  for (i = 0; i < n_selected; i++)
+    {
+      k = selected[i];
+      int s;
+      for (s = 0; s < n_sizes; s++)
+	{
+	  int n = size[s];
+	  double bytes = (double) n * sizeof (int);
+	  if (kernel_table[k].max_size && n > kernel_table[k].max_size)
+	    continue;
+	  double t = time_kernel (k, n, min_time);
+	  double ns = t * 1.0e9 / n;
+	  double gbs = t > 0.0 ? bytes / t * 1.0e-9 : 0.0;
+	  double bpc = hz > 0.0 && t > 0.0 ? bytes / (t * hz) : 0.0;
+	  printf ("%-20s%12d%12.0f%12.3f%10.2f", kernel_table[k].name, n,
+		  bytes, ns, gbs);
+	  if (hz > 0.0)
+	    printf ("%12.3f\n", bpc);
+	  else
+	    printf ("%12s\n", "-");
+	  fflush (stdout);
+	  if (csv != NULL)
+	    {
+	      fprintf (csv, "%s,%d,%.0f,%.6g,%.6g,", kernel_table[k].name, n,
+		       bytes, ns, gbs);
+	      if (hz > 0.0)
+		fprintf (csv, "%.6g", bpc);
+	      fputc ('\n', csv);
+	    }
+	}
+    }
+  if (csv != NULL)
+    fclose (csv);
+  MPI_Finalize ();
+  return 0;
+}
@@ -0,0 +1,318 @@
+/* MPI hierarchical merge sort: within nodes, then across them
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+// mpi_mergesort passes halves down a binary tree of ranks, so most
+// of its transfers cross between nodes whenever ranks span several.
+// Here the ranks of each node (MPI_Comm_split_type with
+// MPI_COMM_TYPE_SHARED) share one MPI-3 shared memory window, and
+// only one leader rank per node talks to the other nodes:
+//
+//   1. rank 0 scatters the array over the leaders, a block per node
+//      in proportion to its ranks;
+//   2. the ranks of each node sort a slice each of the node's block,
+//      in the window, and merge the slices pairwise, each merge split
+//      over all the node's ranks by co-ranking;
+//   3. the leaders gather the sorted blocks to rank 0's window;
+//   4. the ranks of rank 0's node merge the blocks the same way.
+//
+// So each key crosses between nodes twice, out and back, and all
+// merging is in shared memory.  Given RANKS-PER-NODE, each node is
+// split further into "nodes" of that many ranks, to emulate several
+// nodes on one host.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <mpi.h>
+#include "instrument.h"
+#include "sort_tune.h"
+#include "sort_affinity.h"
+#include "sort_validate.h"
+#include "msort.h"
+
+extern double get_time (void);
+void node_sync (MPI_Win win, MPI_Comm node);
+void node_merge_runs (int a[], int temp[], const int bound[], int n_runs,
+		      MPI_Win win, MPI_Comm node);
+int main (int argc, char *argv[]);
+
+int
+main (int argc, char *argv[])
+{
+  MPI_Init (&argc, &argv);
+  int comm_size, my_rank, i;
+  MPI_Comm_size (MPI_COMM_WORLD, &comm_size);
+  MPI_Comm_rank (MPI_COMM_WORLD, &my_rank);
+  // Tuning parameters of this host (rank 0's)
+  tune_load_mpi (MPI_COMM_WORLD);
+  // Placement of the ranks, by $SORT_AFFINITY
+  affinity_init_mpi (MPI_COMM_WORLD, my_rank, 1);
+  int params[2] = { 0, 0 };
+  if (my_rank == 0)
+    {
+      puts ("-MPI Hierarchical Mergesort-\t");
+      if (argc != 2 && argc != 3)
+	{
+	  printf ("Usage: %s array-size [ranks-per-node]\n", argv[0]);
+	  MPI_Abort (MPI_COMM_WORLD, 1);
+	}
+      params[0] = atoi (argv[1]);
+      params[1] = argc == 3 ? atoi (argv[2]) : 0;
+      if (params[0] <= 0 || params[1] < 0)
+	{
+	  printf ("ERROR: invalid arguments\n");
+	  MPI_Abort (MPI_COMM_WORLD, 1);
+	}
+    }
+  MPI_Bcast (params, 2, MPI_INT, 0, MPI_COMM_WORLD);
+  int size = params[0], per_node = params[1];
+
+  // The ranks of this node, and a communicator of the node leaders
+  MPI_Comm node, leaders;
+  int node_rank, node_size;
+  MPI_Comm_split_type (MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, my_rank,
+		       MPI_INFO_NULL, &node);
+  if (per_node > 0)
+    {
+      MPI_Comm emulated;
+      MPI_Comm_rank (node, &node_rank);
+      MPI_Comm_split (node, node_rank / per_node, node_rank, &emulated);
+      MPI_Comm_free (&node);
+      node = emulated;
+    }
+  MPI_Comm_rank (node, &node_rank);
+  MPI_Comm_size (node, &node_size);
+  MPI_Comm_split (MPI_COMM_WORLD, node_rank == 0 ? 0 : MPI_UNDEFINED,
+		  my_rank, &leaders);
+  // Rank 0 leads its node, since ranks are ordered by world rank.
+  int root_node = my_rank == 0;
+  MPI_Bcast (&root_node, 1, MPI_INT, 0, node);
+
+  // Each node's block, in proportion to its ranks
+  int n_nodes = 0, count, *counts = NULL, *displs = NULL;
+  if (leaders != MPI_COMM_NULL)
+    {
+      MPI_Comm_size (leaders, &n_nodes);
+      counts = malloc (sizeof (int) * n_nodes);
+      displs = malloc (sizeof (int) * (n_nodes + 1));
+      MPI_Allgather (&node_size, 1, MPI_INT, counts, 1, MPI_INT, leaders);
+      long ranks = 0;
+      for (i = 0; i < n_nodes; i++)
+	{
+	  displs[i] = (long) size * ranks / comm_size;
+	  ranks += counts[i];
+	}
+      displs[n_nodes] = size;
+      for (i = 0; i < n_nodes; i++)
+	counts[i] = displs[i + 1] - displs[i];
+      MPI_Comm_rank (leaders, &i);
+      count = counts[i];
+    }
+  MPI_Bcast (&count, 1, MPI_INT, 0, node);
+  // Rank 0's node also merges the blocks of all nodes.
+  MPI_Bcast (&n_nodes, 1, MPI_INT, 0, node);
+  if (root_node && node_rank != 0)
+    displs = malloc (sizeof (int) * (n_nodes + 1));
+  if (root_node)
+    MPI_Bcast (displs, n_nodes + 1, MPI_INT, 0, node);
+
+  // The node's window holds the array and a temporary array of the
+  // same size.
+  int capacity = root_node ? size : count;
+  int *a, *temp, disp_unit;
+  MPI_Aint win_size;
+  MPI_Win win;
+  MPI_Win_allocate_shared (node_rank == 0
+			   ? 2 * (MPI_Aint) capacity * sizeof (int) : 0,
+			   sizeof (int), MPI_INFO_NULL, node, &a, &win);
+  MPI_Win_shared_query (win, 0, &win_size, &disp_unit, &a);
+  temp = a + capacity;
+  MPI_Win_lock_all (MPI_MODE_NOCHECK, win);
+
+  struct sort_sum in = { 0, 0 };
+  int validate = 0;
+  if (my_rank == 0)
+    {
+      printf ("Array size = %d\nProcesses = %d\nNodes = %d\n", size,
+	      comm_size, n_nodes);
+      affinity_print ();
+      // Random array initialization
+      srand (314159);
+      for (i = 0; i < size; i++)
+	a[i] = rand () % size;
+      // Checksum of the input, for the result check
+      validate = sort_validate_enabled ();
+      if (validate)
+	in = sort_checksum (a, size);
+    }
+  node_sync (win, node);
+  MPI_Barrier (MPI_COMM_WORLD);
+  double start = get_time ();
+
+  // 1. Scatter the blocks to the nodes
+  if (leaders != MPI_COMM_NULL)
+    {
+      INSTR_START (t_scatter);
+      MPI_Scatterv (a, counts, displs, MPI_INT,
+		    my_rank == 0 ? MPI_IN_PLACE : a, count, MPI_INT, 0,
+		    leaders);
+      INSTR_STOP (t_scatter, INSTR_RECV, count * sizeof (int));
+    }
+  node_sync (win, node);
+
+  // 2. Sort the node's block
+  int *bound = malloc (sizeof (int) * (node_size + 1));
+  for (i = 0; i <= node_size; i++)
+    bound[i] = (long) count * i / node_size;
+  INSTR_START (t_leaf);
+  mergesort_serial (a + bound[node_rank],
+		    bound[node_rank + 1] - bound[node_rank],
+		    temp + bound[node_rank]);
+  INSTR_STOP (t_leaf, INSTR_LEAF_SORT,
+	      (bound[node_rank + 1] - bound[node_rank]) * sizeof (int));
+  node_sync (win, node);
+  node_merge_runs (a, temp, bound, node_size, win, node);
+
+  // 3. Gather the sorted blocks to rank 0's node
+  if (leaders != MPI_COMM_NULL)
+    {
+      INSTR_START (t_gather);
+      MPI_Gatherv (my_rank == 0 ? MPI_IN_PLACE : a, count, MPI_INT,
+		   a, counts, displs, MPI_INT, 0, leaders);
+      INSTR_STOP (t_gather, INSTR_SEND, count * sizeof (int));
+    }
+
+  // 4. Merge them there
+  if (root_node)
+    {
+      node_sync (win, node);
+      node_merge_runs (a, temp, displs, n_nodes, win, node);
+    }
+  double end = get_time ();
+  affinity_release ();
+  if (my_rank == 0)
+    {
+      INSTR_RECORD (INSTR_TOTAL, start, end, size * sizeof (int));
+      printf ("Start = %.2f\nEnd = %.2f\nElapsed = %.6f\n",
+	      start, end, end - start);
+      // Result check
+      if (validate && !sort_validate (a, size, &in))
+	MPI_Abort (MPI_COMM_WORLD, 1);
+      puts ("-Success-");
+    }
+  fflush (stdout);
+  INSTR_REPORT_MPI ("mpi_hier_mergesort", size, MPI_COMM_WORLD);
+  MPI_Win_unlock_all (win);
+  MPI_Win_free (&win);
+  free (bound);
+  free (counts);
+  free (displs);
+  if (leaders != MPI_COMM_NULL)
+    MPI_Comm_free (&leaders);
+  MPI_Comm_free (&node);
+  MPI_Finalize ();
+  return 0;
+}
+
+// Make the stores of all ranks of NODE to WIN visible to all.
+void
+node_sync (MPI_Win win, MPI_Comm node)
+{
+  INSTR_START (t_barrier);
+  MPI_Win_sync (win);
+  MPI_Barrier (node);
+  MPI_Win_sync (win);
+  INSTR_STOP (t_barrier, INSTR_BARRIER, 0);
+}
+
+// The number of elements of X among the first K of the merge of X[0
+// .. M - 1] and Y[0 .. N - 1], which takes X first on ties
+static int
+co_rank (int k, const int x[], int m, const int y[], int n)
+{
+  int lo = k > n ? k - n : 0, hi = k < m ? k : m;
+  while (lo < hi)
+    {
+      int i = lo + (hi - lo) / 2;
+      if (x[i] <= y[k - i - 1])
+	lo = i + 1;
+      else
+	hi = i;
+    }
+  return lo;
+}
+
+static void
+merge_into (const int x[], int m, const int y[], int n, int out[])
+{
+  int i = 0, j = 0, o = 0;
+  while (i < m && j < n)
+    out[o++] = y[j] < x[i] ? y[j++] : x[i++];
+  memcpy (out + o, x + i, (m - i) * sizeof (int));
+  memcpy (out + o + m - i, y + j, (n - j) * sizeof (int));
+}
+
+// Collective over NODE: merge the N_RUNS sorted runs A[BOUND[i] ..
+// BOUND[i + 1] - 1], in the shared window WIN, through TEMP.  Runs
+// are merged pairwise, and each merge is split over all ranks of
+// NODE by co-ranking its output.
+void
+node_merge_runs (int a[], int temp[], const int bound[], int n_runs,
+		 MPI_Win win, MPI_Comm node)
+{
+  int rank, ranks, i;
+  MPI_Comm_rank (node, &rank);
+  MPI_Comm_size (node, &ranks);
+  int *b = malloc (sizeof (int) * (n_runs + 1));
+  int *src = a, *dst = temp;
+  memcpy (b, bound, sizeof (int) * (n_runs + 1));
+  while (n_runs > 1)
+    {
+      INSTR_START (t_merge);
+      for (i = 0; i < n_runs; i += 2)
+	{
+	  // Runs I and I + 1, or run I alone
+	  int lo = b[i], mid = b[i + 1], hi = i + 2 <= n_runs ? b[i + 2] : mid;
+	  int n = hi - lo, m = mid - lo;
+	  int k0 = (long) n * rank / ranks, k1 = (long) n * (rank + 1) / ranks;
+	  int i0 = co_rank (k0, src + lo, m, src + mid, hi - mid);
+	  int i1 = co_rank (k1, src + lo, m, src + mid, hi - mid);
+	  merge_into (src + lo + i0, i1 - i0, src + mid + k0 - i0,
+		      (k1 - i1) - (k0 - i0), dst + lo + k0);
+	}
+      INSTR_STOP_MERGE (t_merge, b[n_runs] - b[0]);
+      for (i = 0; 2 * i < n_runs; i++)
+	b[i] = b[2 * i];
+      b[i] = b[n_runs];
+      n_runs = i;
+      int *t = src;
+      src = dst;
+      dst = t;
+      node_sync (win, node);
+    }
+  if (src != a)
+    {
+      int lo = b[0] + (long) (b[1] - b[0]) * rank / ranks;
+      int hi = b[0] + (long) (b[1] - b[0]) * (rank + 1) / ranks;
+      memcpy (a + lo, src + lo, (hi - lo) * sizeof (int));
+      node_sync (win, node);
+    }
+  free (b);
+}
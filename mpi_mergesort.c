@@ -26,9 +26,13 @@
 #include <string.h>
 #include <math.h>
 #include <mpi.h>
-
-// Arrays size <= SMALL switches to insertion sort
-#define SMALL    32
+#include <omp.h>
+#include "instrument.h"
+#include "sort_tune.h"
+#include "sort_validate.h"
+#include "sort_pack.h"
+#include "sort_affinity.h"
+#include "sort_group.h"
 
 extern double get_time (void);
 void merge (int a[], int size, int temp[]);
@@ -40,6 +44,8 @@ void mergesort_parallel_mpi (int a[], int size, int temp[],
 int my_topmost_level_mpi (int my_rank);
 void run_root_mpi (int a[], int size, int temp[], int max_rank, int tag,
 		   MPI_Comm comm);
+int run_root_groups_mpi (int a[], int size, int temp[], int counts[],
+			 int offsets[], int max_rank, int tag, MPI_Comm comm);
 void run_helper_mpi (int my_rank, int max_rank, int tag, MPI_Comm comm);
 int main (int argc, char *argv[]);
 
@@ -54,25 +60,38 @@ main (int argc, char *argv[])
   MPI_Comm_size (MPI_COMM_WORLD, &comm_size);
   int my_rank;
   MPI_Comm_rank (MPI_COMM_WORLD, &my_rank);
+  // Tuning parameters of this host (rank 0's)
+  tune_load_mpi (MPI_COMM_WORLD);
+  // Placement of the ranks, by $SORT_AFFINITY, in the order of their
+  // subtrees
+  affinity_init_mpi (MPI_COMM_WORLD, affinity_tree_key (my_rank), 1);
   int max_rank = comm_size - 1;
   int tag = 123;
+  int size = 0;
   // Set test data
   if (my_rank == 0)
     {				// Only root process sets test data 
       puts ("-MPI Recursive Mergesort-\t");
       // Check arguments
-      if (argc != 2)		/* argc must be 2 for proper execution! */
+      // -u: unique keys; -c: and their counts; -g: group offsets
+      char mode = argc == 3 && argv[2][0] == '-' ? argv[2][1] : 0;
+      if ((argc != 2 && argc != 3)
+	  || (argc == 3 && (strchr ("ucg", mode) == NULL || argv[2][2])))
 	{
-	  printf ("Usage: %s array-size\n", argv[0]);
+	  printf ("Usage: %s array-size [-u|-c|-g]\n", argv[0]);
 	  MPI_Abort (MPI_COMM_WORLD, 1);
 	}
       // Get argument
-      int size = atoi (argv[1]);	// Array size
+      size = atoi (argv[1]);	// Array size
       printf ("Array size = %d\nProcesses = %d\n", size, comm_size);
+      affinity_print ();
       // Array allocation
       int *a = malloc (sizeof (int) * size);
       int *temp = malloc (sizeof (int) * size);
-      if (a == NULL || temp == NULL)
+      int *counts = mode == 'c' ? malloc (sizeof (int) * size) : NULL;
+      int *offsets = mode == 'g' ? malloc (sizeof (int) * (size + 1)) : NULL;
+      if (a == NULL || temp == NULL || (mode == 'c' && counts == NULL)
+	  || (mode == 'g' && offsets == NULL))
 	{
 	  printf ("Error: Could not allocate array of size %d\n", size);
 	  MPI_Abort (MPI_COMM_WORLD, 1);
@@ -84,28 +103,42 @@ main (int argc, char *argv[])
 	{
 	  a[i] = rand () % size;
 	}
+      // Checksum of the input, for the result check
+      struct sort_sum in = { 0, 0 };
+      int validate = sort_validate_enabled ();
+      if (validate)
+	in = sort_checksum (a, size);
       // Sort with root process
       double start = get_time ();
-      run_root_mpi (a, size, temp, max_rank, tag, MPI_COMM_WORLD);
+      int groups = 0;
+      if (mode)
+	groups = run_root_groups_mpi (a, size, temp, counts, offsets,
+				      max_rank, tag, MPI_COMM_WORLD);
+      else
+	run_root_mpi (a, size, temp, max_rank, tag, MPI_COMM_WORLD);
       double end = get_time ();
-      printf ("Start = %.2f\nEnd = %.2f\nElapsed = %.2f\n",
+      INSTR_RECORD (INSTR_TOTAL, start, end, size * sizeof (int));
+      affinity_release ();
+      printf ("Start = %.2f\nEnd = %.2f\nElapsed = %.6f\n",
 	      start, end, end - start);
+      if (mode)
+	printf ("Groups = %d\n", groups);
       // Result check
-      for (i = 1; i < size; i++)
-	{
-	  if (!(a[i - 1] <= a[i]))
-	    {
-	      printf ("Implementation error: a[%d]=%d > a[%d]=%d\n", i - 1,
-		      a[i - 1], i, a[i]);
-	      MPI_Abort (MPI_COMM_WORLD, 1);
-	    }
-	}
+      int ok = 1;
+      if (validate && (mode == 'u' || mode == 'c'))
+	ok = sort_validate_counts (a, counts, groups, &in);
+      else if (validate)
+	ok = sort_validate (a, size, &in)
+	  && (mode != 'g' || sort_validate_offsets (a, size, offsets, groups));
+      if (!ok)
+	MPI_Abort (MPI_COMM_WORLD, 1);
     }				// Root process end
   else
     {				// Helper processes  
       run_helper_mpi (my_rank, max_rank, tag, MPI_COMM_WORLD);
     }
   fflush (stdout);
+  INSTR_REPORT_MPI ("mpi_mergesort", size, MPI_COMM_WORLD);
   MPI_Finalize ();
   return 0;
 }
@@ -129,6 +162,42 @@ run_root_mpi (int a[], int size, int temp[], int max_rank, int tag,
   return;
 }
 
+// Root process code for -u, -c and -g: as run_root_mpi, but the
+// last merge, of the two halves, is merge_groups', on all OpenMP
+// threads.  Returns the number of groups.
+int
+run_root_groups_mpi (int a[], int size, int temp[], int counts[],
+		     int offsets[], int max_rank, int tag, MPI_Comm comm)
+{
+  if (max_rank == 0)
+    {
+      INSTR_START (t_leaf);
+      mergesort_serial (a, size / 2, temp);
+      mergesort_serial (a + size / 2, size - size / 2, temp + size / 2);
+      INSTR_STOP (t_leaf, INSTR_LEAF_SORT, size * sizeof (int));
+    }
+  else
+    {
+      MPI_Request request;
+      // Send second half to rank 1, and sort the first, as at level 0
+      // of mergesort_parallel_mpi
+      INSTR_START (t_isend);
+      MPI_Isend (a + size / 2, size - size / 2, MPI_INT, 1, tag, comm,
+		 &request);
+      INSTR_STOP (t_isend, INSTR_ISEND, (size - size / 2) * sizeof (int));
+      mergesort_parallel_mpi (a, size / 2, temp, 1, 0, max_rank, tag, comm);
+      MPI_Request_free (&request);
+      INSTR_START (t_recv);
+      pack_recv_mpi (a + size / 2, size - size / 2, 1, tag, comm);
+      INSTR_STOP (t_recv, INSTR_RECV, (size - size / 2) * sizeof (int));
+    }
+  INSTR_START (t_merge);
+  int groups = merge_groups (a, size, size / 2, temp, counts, offsets,
+			     omp_get_max_threads ());
+  INSTR_STOP_MERGE (t_merge, size);
+  return groups;
+}
+
 // Helper process code
 void
 run_helper_mpi (int my_rank, int max_rank, int tag, MPI_Comm comm)
@@ -143,10 +212,18 @@ run_helper_mpi (int my_rank, int max_rank, int tag, MPI_Comm comm)
   // allocate int a[size], temp[size] 
   int *a = malloc (sizeof (int) * size);
   int *temp = malloc (sizeof (int) * size);
+  INSTR_START (t_recv);
+  double recv_start = get_time ();
   MPI_Recv (a, size, MPI_INT, parent_rank, tag, comm, &status);
+  // Bandwidth of the link to the parent, to judge whether packing the
+  // sorted array pays
+  double bandwidth = size * sizeof (int) / (get_time () - recv_start);
+  INSTR_STOP (t_recv, INSTR_RECV, size * sizeof (int));
   mergesort_parallel_mpi (a, size, temp, level, my_rank, max_rank, tag, comm);
   // Send sorted array to parent process
-  MPI_Send (a, size, MPI_INT, parent_rank, tag, comm);
+  INSTR_START (t_send);
+  pack_send_mpi (a, size, parent_rank, tag, comm, bandwidth);
+  INSTR_STOP (t_send, INSTR_SEND, size * sizeof (int));
   return;
 }
 
@@ -170,26 +247,34 @@ mergesort_parallel_mpi (int a[], int size, int temp[],
   int helper_rank = my_rank + pow (2, level);
   if (helper_rank > max_rank)
     {				// no more processes available
+      INSTR_START (t_leaf);
       mergesort_serial (a, size, temp);
+      INSTR_STOP (t_leaf, INSTR_LEAF_SORT, size * sizeof (int));
     }
   else
     {
 //printf("Process %d has helper %d\n", my_rank, helper_rank);
+      INSTR_START (t_sort);
       MPI_Request request;
-      MPI_Status status;
       // Send second half, asynchronous
+      INSTR_START (t_isend);
       MPI_Isend (a + size / 2, size - size / 2, MPI_INT, helper_rank, tag,
 		 comm, &request);
+      INSTR_STOP (t_isend, INSTR_ISEND, (size - size / 2) * sizeof (int));
       // Sort first half
       mergesort_parallel_mpi (a, size / 2, temp, level + 1, my_rank, max_rank,
 			      tag, comm);
       // Free the async request (matching receive will complete the transfer).
       MPI_Request_free (&request);
       // Receive second half sorted
-      MPI_Recv (a + size / 2, size - size / 2, MPI_INT, helper_rank, tag,
-		comm, &status);
+      INSTR_START (t_recv);
+      pack_recv_mpi (a + size / 2, size - size / 2, helper_rank, tag, comm);
+      INSTR_STOP (t_recv, INSTR_RECV, (size - size / 2) * sizeof (int));
       // Merge the two sorted sub-arrays through temp
+      INSTR_START (t_merge);
       merge (a, size, temp);
+      INSTR_STOP_MERGE (t_merge, size);
+      INSTR_STOP (t_sort, INSTR_SORT, size * sizeof (int));
     }
   return;
 }
@@ -198,7 +283,7 @@ void
 mergesort_serial (int a[], int size, int temp[])
 {
   // Switch to insertion sort for small arrays
-  if (size <= SMALL)
+  if (size <= sort_tune.small)
     {
       insertion_sort (a, size);
       return;
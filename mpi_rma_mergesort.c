@@ -27,17 +27,26 @@
 #include <string.h>
 #include <math.h>
 #include <mpi.h>
-
-// Arrays size <= SMALL switches to insertion sort
-#define SMALL    32
+#include "instrument.h"
+#include "sort_tune.h"
+#include "sort_validate.h"
+#include "sort_dataflow.h"
+#include "sort_affinity.h"
 
 extern double get_time (void);
 void insertion_sort (int a[], int size);
 void mergesort_serial (int a[], int size, int temp[]);
 void merge (int a[], int size, int left_size, int temp[]);
+void merge_rget (int a[], int size, int left_size, int temp[], int partner);
+int block_size_for (int size);
+int local_capacity (int rank, int size, int block_size);
 void parallel_block_mergesort_rma (int a[], int size);
+void parallel_block_mergesort_local (int a[], int size);
 int main (int argc, char *argv[]);
 
+// Keys per MPI_Rget of a partner's half, with -l
+#define RGET_SEGMENT 65536
+
 int debug = 1;
 
 int comm_size, my_rank, max_rank;
@@ -46,25 +55,33 @@ MPI_Win win;
 int
 main (int argc, char *argv[])
 {
-  int size;
+  int size, local = 0;
   int *a;
+  struct sort_sum in = { 0, 0 };
+  int validate = 0;
   // All processes
   MPI_Init (&argc, &argv);
   // Check processes and their ranks.
   // number of processes == communicator size
   MPI_Comm_size (MPI_COMM_WORLD, &comm_size);
   MPI_Comm_rank (MPI_COMM_WORLD, &my_rank);
+  // Tuning parameters of this host (rank 0's)
+  tune_load_mpi (MPI_COMM_WORLD);
+  // Placement of the ranks, by $SORT_AFFINITY
+  affinity_init_mpi (MPI_COMM_WORLD, my_rank, 1);
   max_rank = comm_size - 1;
   if (!my_rank)
     {
       // Rank 0.
       puts ("-MPI RMA Recursive Mergesort-\t");
       // Check arguments
-      if (argc != 2)
+      if (argc != 2 && (argc != 3 || strcmp (argv[2], "-l") != 0))
 	{
-	  printf ("Usage: %s array-size\n", argv[0]);
+	  printf ("Usage: %s array-size [-l]\n", argv[0]);
 	  MPI_Abort (MPI_COMM_WORLD, 1);
 	}
+      // With -l, each rank keeps its chunks in its own memory.
+      local = argc == 3;
       // Get arguments
       size = atoi (argv[1]);	// Array size
       if (size <= 0)
@@ -73,8 +90,10 @@ main (int argc, char *argv[])
 	  MPI_Abort (MPI_COMM_WORLD, 1);
 	}
       printf ("Array size = %d\nProcesses = %d\n\n", size, comm_size);
+      affinity_print ();
       MPI_Bcast (&size, 1, MPI_INT, 0, MPI_COMM_WORLD);
-      // All shared storage is on rank 0.
+      MPI_Bcast (&local, 1, MPI_INT, 0, MPI_COMM_WORLD);
+      // The array is on rank 0.
       MPI_Win_allocate (size * sizeof (int), sizeof (int), MPI_INFO_NULL,
 			MPI_COMM_WORLD, &a, &win);
       // Random array initialization
@@ -83,37 +102,48 @@ main (int argc, char *argv[])
 	{
 	  a[i] = rand () % size;
 	}
+      // Checksum of the input, for the result check
+      validate = sort_validate_enabled ();
+      if (validate)
+	in = sort_checksum (a, size);
     }
   else
     {
       // Not rank 0.
       MPI_Bcast (&size, 1, MPI_INT, 0, MPI_COMM_WORLD);
-      //  Allocation size is 0. This rank doesn't contribute to 'a'.
-      MPI_Win_allocate (0, 1, MPI_INFO_NULL, MPI_COMM_WORLD, &a, &win);
+      MPI_Bcast (&local, 1, MPI_INT, 0, MPI_COMM_WORLD);
+      //  Allocation size is 0. This rank doesn't contribute to 'a',
+      //  but with -l it holds its largest chunk.
+      int capacity = local
+	? local_capacity (my_rank, size, block_size_for (size)) : 0;
+      MPI_Win_allocate (capacity * sizeof (int), sizeof (int), MPI_INFO_NULL,
+			MPI_COMM_WORLD, &a, &win);
     }
+  MPI_Bcast (&validate, 1, MPI_INT, 0, MPI_COMM_WORLD);
   MPI_Win_lock_all (MPI_MODE_NOCHECK, win);
   MPI_Barrier (MPI_COMM_WORLD);
   double start = get_time ();
   // All ranks execute the parallel block merge procedure.
-  parallel_block_mergesort_rma (a, size);
+  if (local)
+    parallel_block_mergesort_local (a, size);
+  else
+    parallel_block_mergesort_rma (a, size);
   double end = get_time ();
+  affinity_release ();
+  if (!my_rank)
+    INSTR_RECORD (INSTR_TOTAL, start, end, size * sizeof (int));
   if (!my_rank)
     {
-      printf ("Start = %.2f\nEnd = %.2f\nElapsed = %.2f\n",
+      printf ("Start = %.2f\nEnd = %.2f\nElapsed = %.6f\n",
 	      start, end, end - start);
-      // Result check
-      for (int i = 1; i < size; i++)
-	{
-	  if (!(a[i - 1] <= a[i]))
-	    {
-	      printf ("Implementation error: a[%d]=%d > a[%d]=%d\n", i - 1,
-		      a[i - 1], i, a[i]);
-	      MPI_Abort (MPI_COMM_WORLD, 1);
-	    }
-	}
-      puts ("-Success-");
     }
+  // Result check, shared by all ranks
+  if (validate && !sort_validate_rma (win, size, &in, MPI_COMM_WORLD))
+    MPI_Abort (MPI_COMM_WORLD, 1);
+  if (!my_rank)
+    puts ("-Success-");
   fflush (stdout);
+  INSTR_REPORT_MPI ("mpi_rma_mergesort", size, MPI_COMM_WORLD);
   MPI_Win_unlock_all (win);
   MPI_Win_free (&win);
   MPI_Finalize ();
@@ -149,13 +179,13 @@ parallel_block_mergesort_rma (int a[], int size)
 	      "on rank %d\n", size, my_rank);
       MPI_Abort (MPI_COMM_WORLD, 1);
     }
-  // Blocks are evenly distributed across ranks.
-  int block_size = (size + comm_size - 1) / comm_size;
-  // For small problems, do everything on rank 0.
-  if (block_size <= 1024)
-    block_size = size;
-  for (int blocks_per_chunk = 1, chunk_size = block_size;
-       chunk_size <= size * 2; blocks_per_chunk *= 2, chunk_size *= 2)
+  // Completion flags of the passes (see sort_dataflow.h)
+  struct pass_flags flags;
+  pass_flags_init_mpi (&flags, MPI_COMM_WORLD);
+  int block_size = block_size_for (size);
+  for (int level = 0, blocks_per_chunk = 1, chunk_size = block_size;
+       chunk_size <= size * 2;
+       level++, blocks_per_chunk *= 2, chunk_size *= 2)
     {
       int chunk_offset = my_rank * block_size;
       // If this rank is a group leader this pass,
@@ -168,58 +198,255 @@ parallel_block_mergesort_rma (int a[], int size)
 	  int *chunk_local = a_local + chunk_offset;
 	  int *chunk_temp = temp + chunk_offset;
 	  int half_chunk = chunk_size / 2;
+	  if (blocks_per_chunk > 1 && this_chunk_size > half_chunk)
+	    {
+	      // Wait for the rank that sorted the second half, then
+	      // see its puts in rank 0's memory.
+	      INSTR_START (t_wait);
+	      pass_wait_mpi (&flags, level);
+	      MPI_Win_sync (win);
+	      INSTR_STOP (t_wait, INSTR_BARRIER, 0);
+	    }
 	  if (blocks_per_chunk == 1)
 	    {
 	      if (!my_rank)
-		mergesort_serial (chunk_local, this_chunk_size, chunk_temp);
+		{
+		  INSTR_START (t_leaf);
+		  mergesort_serial (chunk_local, this_chunk_size, chunk_temp);
+		  INSTR_STOP (t_leaf, INSTR_LEAF_SORT,
+			      this_chunk_size * sizeof (int));
+		}
 	      else
 		{
 		  // Copy unsorted chunk from rank 0.
+		  INSTR_START (t_get);
 		  MPI_Get (chunk_local, this_chunk_size, MPI_INT,
 			   0, chunk_offset, this_chunk_size, MPI_INT, win);
 		  MPI_Win_flush_local (0, win);
+		  INSTR_STOP (t_get, INSTR_GET, this_chunk_size * sizeof (int));
+		  INSTR_START (t_leaf);
 		  mergesort_serial (chunk_local, this_chunk_size, chunk_temp);
+		  INSTR_STOP (t_leaf, INSTR_LEAF_SORT,
+			      this_chunk_size * sizeof (int));
 		  // Copy sorted chunk back to rank 0.
+		  INSTR_START (t_put);
 		  MPI_Put (chunk_local, this_chunk_size, MPI_INT,
 			   0, chunk_offset, this_chunk_size, MPI_INT, win);
 		  MPI_Win_flush (0, win);
+		  INSTR_STOP (t_put, INSTR_PUT, this_chunk_size * sizeof (int));
 		}
 	    }
 	  else if (this_chunk_size > half_chunk)
 	    {
 	      if (!my_rank)
-		merge (chunk_local, this_chunk_size, half_chunk, chunk_temp);
+		{
+		  INSTR_START (t_merge);
+		  merge (chunk_local, this_chunk_size, half_chunk, chunk_temp);
+		  INSTR_STOP_MERGE (t_merge, this_chunk_size);
+		}
 	      else
 		{
 		  int bottom_half_size = this_chunk_size - half_chunk;
 		  // Copy bottom half from previous iteration.
+		  INSTR_START (t_get);
 		  MPI_Get (chunk_local + half_chunk,
 			   bottom_half_size, MPI_INT,
 			   0, chunk_offset + half_chunk,
 			   bottom_half_size, MPI_INT, win);
 		  MPI_Win_flush_local (0, win);
+		  INSTR_STOP (t_get, INSTR_GET, bottom_half_size * sizeof (int));
+		  INSTR_START (t_merge);
 		  merge (chunk_local, this_chunk_size,
 			 half_chunk, chunk_temp);
+		  INSTR_STOP_MERGE (t_merge, this_chunk_size);
 		  // Copy merged chunk back to rank 0.
+		  INSTR_START (t_put);
 		  MPI_Put (chunk_local, this_chunk_size, MPI_INT,
 			   0, chunk_offset, this_chunk_size, MPI_INT, win);
 		  MPI_Win_flush (0, win);
+		  INSTR_STOP (t_put, INSTR_PUT, this_chunk_size * sizeof (int));
 		}
 	    }
 	}
-      // Wait for this phase to complete.
-      MPI_Barrier (MPI_COMM_WORLD);
+      else
+	{
+	  // No longer a group leader: this rank's last chunk is done.
+	  // Signal the leader that merges it, and stop.
+	  if (chunk_offset < size)
+	    pass_signal_mpi (&flags, my_rank - blocks_per_chunk / 2, level);
+	  break;
+	}
     }
   if (my_rank != 0)
     free (a_local);
+  pass_flags_free_mpi (&flags);
+  free (temp);
+}
+
+// Blocks are evenly distributed across ranks.
+int
+block_size_for (int size)
+{
+  int block_size = (size + comm_size - 1) / comm_size;
+  // For small problems, do everything on rank 0.
+  if (block_size <= sort_tune.block_min)
+    block_size = size;
+  return block_size;
+}
+
+// Elements of RANK's part of the window with -l: its largest chunk,
+// of 2^k blocks for the 2^k that divides RANK, or for rank 0 the
+// array.
+int
+local_capacity (int rank, int size, int block_size)
+{
+  if (rank == 0)
+    return size;
+  long offset = (long) rank * block_size;
+  if (offset >= size)
+    return 0;
+  long capacity = (long) block_size * (rank & -rank);
+  return capacity < size - offset ? capacity : size - offset;
+}
+
+// With -l, each rank sorts and merges its chunks in its own part of
+// the window, a.  A leader pulls only its partner's half, from the
+// partner's part, and merges it as it arrives.  The last merge is by
+// rank 0, so it leaves the sorted array in place on rank 0.
+void
+parallel_block_mergesort_local (int a[], int size)
+{
+  int block_size = block_size_for (size);
+  int capacity = local_capacity (my_rank, size, block_size);
+  int *temp = malloc ((capacity > 0 ? capacity : 1) * sizeof (int));
+  if (temp == NULL)
+    {
+      printf ("Error: Could not allocate temporary array of size %d "
+	      "on rank %d\n", capacity, my_rank);
+      MPI_Abort (MPI_COMM_WORLD, 1);
+    }
+  // Completion flags of the passes (see sort_dataflow.h)
+  struct pass_flags flags;
+  pass_flags_init_mpi (&flags, MPI_COMM_WORLD);
+  for (int level = 0, blocks_per_chunk = 1, chunk_size = block_size;
+       chunk_size <= size * 2;
+       level++, blocks_per_chunk *= 2, chunk_size *= 2)
+    {
+      int chunk_offset = my_rank * block_size;
+      // If this rank is a group leader this pass,
+      //  execute the sort/merge step.
+      if (((my_rank % blocks_per_chunk) == 0) && (chunk_offset < size))
+	{
+	  int rem_size = size - chunk_offset;
+	  int this_chunk_size = rem_size >= chunk_size
+	    ? chunk_size : rem_size;
+	  int half_chunk = chunk_size / 2;
+	  if (blocks_per_chunk == 1)
+	    {
+	      if (my_rank)
+		{
+		  // Copy unsorted block from rank 0.
+		  INSTR_START (t_get);
+		  MPI_Get (a, this_chunk_size, MPI_INT,
+			   0, chunk_offset, this_chunk_size, MPI_INT, win);
+		  MPI_Win_flush_local (0, win);
+		  INSTR_STOP (t_get, INSTR_GET, this_chunk_size * sizeof (int));
+		}
+	      INSTR_START (t_leaf);
+	      mergesort_serial (a, this_chunk_size, temp);
+	      INSTR_STOP (t_leaf, INSTR_LEAF_SORT,
+			  this_chunk_size * sizeof (int));
+	    }
+	  else if (this_chunk_size > half_chunk)
+	    {
+	      // Wait for the rank that sorted the second half.
+	      INSTR_START (t_wait);
+	      pass_wait_mpi (&flags, level);
+	      INSTR_STOP (t_wait, INSTR_BARRIER, 0);
+	      merge_rget (a, this_chunk_size, half_chunk, temp,
+			  my_rank + blocks_per_chunk / 2);
+	    }
+	}
+      else
+	{
+	  // No longer a group leader: this rank's last chunk is done.
+	  // Make it visible to the leader's MPI_Rget, signal the
+	  // leader, and stop.
+	  if (chunk_offset < size)
+	    {
+	      MPI_Win_sync (win);
+	      pass_signal_mpi (&flags, my_rank - blocks_per_chunk / 2, level);
+	    }
+	  break;
+	}
+    }
+  pass_flags_free_mpi (&flags);
   free (temp);
 }
 
+// Merge A[0 .. LEFT_SIZE - 1] with the SIZE - LEFT_SIZE sorted keys
+// at the start of rank PARTNER's part of the window.  They are pulled
+// into A[LEFT_SIZE .. SIZE - 1] by an MPI_Rget per segment of
+// RGET_SEGMENT keys, and each segment is merged as soon as it
+// arrives.
+void
+merge_rget (int a[], int size, int left_size, int temp[], int partner)
+{
+  int right_size = size - left_size;
+  int n_seg = (right_size + RGET_SEGMENT - 1) / RGET_SEGMENT, s;
+  MPI_Request *req = malloc (n_seg * sizeof (MPI_Request));
+  if (req == NULL)
+    {
+      printf ("Error: Could not allocate %d requests on rank %d\n",
+	      n_seg, my_rank);
+      MPI_Abort (MPI_COMM_WORLD, 1);
+    }
+  INSTR_START (t_get);
+  for (s = 0; s < n_seg; s++)
+    {
+      int lo = s * RGET_SEGMENT;
+      int n = right_size - lo < RGET_SEGMENT ? right_size - lo : RGET_SEGMENT;
+      MPI_Rget (a + left_size + lo, n, MPI_INT, partner, lo, n, MPI_INT,
+		win, &req[s]);
+    }
+  INSTR_STOP (t_get, INSTR_GET, right_size * sizeof (int));
+  // Waits for the segments are counted in the merge.
+  INSTR_START (t_merge);
+  int i1 = 0;
+  int i2 = left_size;
+  int tempi = 0;
+  int avail = left_size;
+  s = 0;
+  while (i1 < left_size && i2 < size)
+    {
+      if (i2 == avail)
+	{
+	  MPI_Wait (&req[s++], MPI_STATUS_IGNORE);
+	  avail = s < n_seg ? left_size + s * RGET_SEGMENT : size;
+	}
+      while (i1 < left_size && i2 < avail)
+	{
+	  if (a[i1] < a[i2])
+	    temp[tempi++] = a[i1++];
+	  else
+	    temp[tempi++] = a[i2++];
+	}
+    }
+  MPI_Waitall (n_seg - s, req + s, MPI_STATUSES_IGNORE);
+  memcpy (temp + tempi, a + i1, (left_size - i1) * sizeof (int));
+  tempi += left_size - i1;
+  memcpy (temp + tempi, a + i2, (size - i2) * sizeof (int));
+  // Copy sorted temp array into main array, a
+  memcpy (a, temp, size * sizeof (int));
+  INSTR_STOP_MERGE (t_merge, size);
+  free (req);
+}
+
 void
 mergesort_serial (int a[], int size, int temp[])
 {
   // Switch to insertion sort for small arrays
-  if (size <= SMALL)
+  if (size <= sort_tune.small)
     {
       insertion_sort (a, size);
       return;
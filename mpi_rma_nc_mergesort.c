@@ -30,9 +30,11 @@
 #include <string.h>
 #include <math.h>
 #include <mpi.h>
-
-// Arrays size <= SMALL switches to insertion sort
-#define SMALL    32
+#include "instrument.h"
+#include "sort_tune.h"
+#include "sort_validate.h"
+#include "sort_dataflow.h"
+#include "sort_affinity.h"
 
 extern double get_time (void);
 void insertion_sort (int a[], int size);
@@ -54,12 +56,18 @@ main (int argc, char *argv[])
 {
   int size;
   int *a;
+  struct sort_sum in = { 0, 0 };
+  int validate = 0;
   // All processes
   MPI_Init (&argc, &argv);
   // Check processes and their ranks.
   // number of processes == communicator size
   MPI_Comm_size (MPI_COMM_WORLD, &comm_size);
   MPI_Comm_rank (MPI_COMM_WORLD, &my_rank);
+  // Tuning parameters of this host (rank 0's)
+  tune_load_mpi (MPI_COMM_WORLD);
+  // Placement of the ranks, by $SORT_AFFINITY
+  affinity_init_mpi (MPI_COMM_WORLD, my_rank, 1);
   max_rank = comm_size - 1;
   if (!my_rank)
     {
@@ -79,6 +87,7 @@ main (int argc, char *argv[])
 	  MPI_Abort (MPI_COMM_WORLD, 1);
 	}
       printf ("Array size = %d\nProcesses = %d\n\n", size, comm_size);
+      affinity_print ();
       MPI_Bcast (&size, 1, MPI_INT, 0, MPI_COMM_WORLD);
       // All shared storage is on rank 0.
       MPI_Win_allocate (size * sizeof (int), sizeof (int), MPI_INFO_NULL,
@@ -89,6 +98,10 @@ main (int argc, char *argv[])
 	{
 	  a[i] = rand () % size;
 	}
+      // Checksum of the input, for the result check
+      validate = sort_validate_enabled ();
+      if (validate)
+	in = sort_checksum (a, size);
     }
   else
     {
@@ -97,29 +110,28 @@ main (int argc, char *argv[])
       //  Allocation size is 0. This rank doesn't contribute to 'a'.
       MPI_Win_allocate (0, 1, MPI_INFO_NULL, MPI_COMM_WORLD, &a, &win);
     }
+  MPI_Bcast (&validate, 1, MPI_INT, 0, MPI_COMM_WORLD);
   MPI_Win_lock_all (MPI_MODE_NOCHECK, win);
   MPI_Barrier (MPI_COMM_WORLD);
   double start = get_time ();
   // All ranks execute the parallel block merge procedure.
   parallel_block_mergesort_rma (a, size);
   double end = get_time ();
+  affinity_release ();
+  if (!my_rank)
+    INSTR_RECORD (INSTR_TOTAL, start, end, size * sizeof (int));
   if (!my_rank)
     {
-      printf ("Start = %.2f\nEnd = %.2f\nElapsed = %.2f\n",
+      printf ("Start = %.2f\nEnd = %.2f\nElapsed = %.6f\n",
 	      start, end, end - start);
-      // Result check
-      for (int i = 1; i < size; i++)
-	{
-	  if (!(a[i - 1] <= a[i]))
-	    {
-	      printf ("Implementation error: a[%d]=%d > a[%d]=%d\n", i - 1,
-		      a[i - 1], i, a[i]);
-	      MPI_Abort (MPI_COMM_WORLD, 1);
-	    }
-	}
-      puts ("-Success-");
     }
+  // Result check, shared by all ranks
+  if (validate && !sort_validate_rma (win, size, &in, MPI_COMM_WORLD))
+    MPI_Abort (MPI_COMM_WORLD, 1);
+  if (!my_rank)
+    puts ("-Success-");
   fflush (stdout);
+  INSTR_REPORT_MPI ("mpi_rma_nc_mergesort", size, MPI_COMM_WORLD);
   MPI_Win_unlock_all (win);
   MPI_Win_free (&win);
   MPI_Finalize ();
@@ -139,13 +151,17 @@ parallel_block_mergesort_rma (int a[], int size)
 	      "on rank %d\n", size, my_rank);
       MPI_Abort (MPI_COMM_WORLD, 1);
     }
+  // Completion flags of the passes (see sort_dataflow.h)
+  struct pass_flags flags;
+  pass_flags_init_mpi (&flags, MPI_COMM_WORLD);
   // Blocks are evenly distributed across ranks.
   int block_size = (size + comm_size - 1) / comm_size;
   // For small problems, do everything on rank 0.
-  if (block_size <= 1024)
+  if (block_size <= sort_tune.block_min)
     block_size = size;
-  for (int blocks_per_chunk = 1, chunk_size = block_size;
-       chunk_size <= size * 2; blocks_per_chunk *= 2, chunk_size *= 2)
+  for (int level = 0, blocks_per_chunk = 1, chunk_size = block_size;
+       chunk_size <= size * 2;
+       level++, blocks_per_chunk *= 2, chunk_size *= 2)
     {
       int chunk_offset = my_rank * block_size;
       // If this rank is a group leader this pass,
@@ -157,6 +173,16 @@ parallel_block_mergesort_rma (int a[], int size)
 	    ? chunk_size : rem_size;
 	  int *chunk_temp = temp + chunk_offset;
 	  int half_chunk = chunk_size / 2;
+	  if (blocks_per_chunk > 1 && this_chunk_size > half_chunk)
+	    {
+	      // Wait for the rank that sorted the second half, then
+	      // see its puts in rank 0's memory.
+	      INSTR_START (t_wait);
+	      pass_wait_mpi (&flags, level);
+	      MPI_Win_sync (win);
+	      INSTR_STOP (t_wait, INSTR_BARRIER, 0);
+	    }
+	  INSTR_START (t_step);
 	  if (!my_rank)
 	    {
 	      // On rank 0, we can localize the array by casting it.
@@ -176,10 +202,23 @@ parallel_block_mergesort_rma (int a[], int size)
 		merge_rma (chunk_offset, this_chunk_size,
 		           half_chunk, chunk_temp);
 	    }
+	  // Remote element accesses are counted as part of the step.
+	  if (blocks_per_chunk == 1)
+	    INSTR_STOP (t_step, INSTR_LEAF_SORT,
+			this_chunk_size * sizeof (int));
+	  else if (this_chunk_size > half_chunk)
+	    INSTR_STOP_MERGE (t_step, this_chunk_size);
+	}
+      else
+	{
+	  // No longer a group leader: this rank's last chunk is done.
+	  // Signal the leader that merges it, and stop.
+	  if (chunk_offset < size)
+	    pass_signal_mpi (&flags, my_rank - blocks_per_chunk / 2, level);
+	  break;
 	}
-      // Wait for this phase to complete.
-      MPI_Barrier (MPI_COMM_WORLD);
     }
+  pass_flags_free_mpi (&flags);
   free (temp);
 }
 
@@ -187,7 +226,7 @@ void
 mergesort_rma (int a_offset, int size, int temp[])
 {
   // Switch to insertion sort for small arrays
-  if (size <= SMALL)
+  if (size <= sort_tune.small)
     {
       insertion_sort_rma (a_offset, size);
       return;
@@ -301,7 +340,7 @@ void
 mergesort_serial (int a[], int size, int temp[])
 {
   // Switch to insertion sort for small arrays
-  if (size <= SMALL)
+  if (size <= sort_tune.small)
     {
       insertion_sort (a, size);
       return;
@@ -0,0 +1,330 @@
+/* Distributed top-k and quantile selection with MPI.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+// The MPI counterpart of msort_select.c.  The root scatters the
+// array in blocks; then each global order statistic is found without
+// sorting, by rounds of:
+//
+//   - each rank takes the median of its remaining candidates;
+//   - all ranks agree on the weighted median of those medians, as
+//     the pivot, which splits off at least a quarter of the
+//     remaining candidates;
+//   - each rank partitions its candidates about the pivot, and an
+//     allreduce of the counts tells which side holds the rank
+//     sought.
+//
+// Once few candidates remain, they are gathered and selected on
+// every rank.  The K smallest are those less than the K-th, and
+// enough of those equal to it; they are gathered to the root and
+// sorted there, so the whole costs O(n / P + k log k) plus O(log n)
+// small collectives.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <mpi.h>
+#include "instrument.h"
+#include "sort_tune.h"
+#include "sort_affinity.h"
+#include "msort.h"
+
+// Remaining candidates, over all ranks, that are selected locally
+#define GATHER_MAX 65536
+
+#define MAX_QUANTILES 64
+
+extern double get_time (void);
+int select_kth_mpi (int a[], int size, long k, MPI_Comm comm);
+int topk_mpi (int a[], int size, int k, int out[], MPI_Comm comm);
+int main (int argc, char *argv[]);
+
+struct weighted
+{
+  int value, weight;
+};
+
+static int
+weighted_less (const void *x, const void *y)
+{
+  int a = ((const struct weighted *) x)->value;
+  int b = ((const struct weighted *) y)->value;
+  return (a > b) - (a < b);
+}
+
+int
+main (int argc, char *argv[])
+{
+  MPI_Init (&argc, &argv);
+  int comm_size, my_rank;
+  MPI_Comm_size (MPI_COMM_WORLD, &comm_size);
+  MPI_Comm_rank (MPI_COMM_WORLD, &my_rank);
+  // Tuning parameters of this host (rank 0's)
+  tune_load_mpi (MPI_COMM_WORLD);
+  // Placement of the ranks, by $SORT_AFFINITY
+  affinity_init_mpi (MPI_COMM_WORLD, my_rank, 1);
+  int size = 0, k = 0, n_q = 0, i;
+  double q[MAX_QUANTILES];
+  if (my_rank == 0)
+    {
+      puts ("-MPI Top-k and Quantile Selection-\t");
+      if (argc < 3 || argc - 3 > MAX_QUANTILES)
+	{
+	  printf ("Usage: %s array-size k [quantile ...]\n", argv[0]);
+	  MPI_Abort (MPI_COMM_WORLD, 1);
+	}
+      size = atoi (argv[1]);
+      k = atoi (argv[2]);
+      if (k > size)
+	k = size;
+      for (i = 3; i < argc; i++)
+	q[n_q++] = atof (argv[i]);
+      printf ("Array size = %d\nProcesses = %d\nK = %d\n", size, comm_size,
+	      k);
+      affinity_print ();
+    }
+  int params[3] = { size, k, n_q };
+  MPI_Bcast (params, 3, MPI_INT, 0, MPI_COMM_WORLD);
+  size = params[0], k = params[1], n_q = params[2];
+  MPI_Bcast (q, n_q, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+  // Block of each rank
+  int *counts = malloc (sizeof (int) * comm_size);
+  int *displs = malloc (sizeof (int) * comm_size);
+  for (i = 0; i < comm_size; i++)
+    {
+      displs[i] = (long) size * i / comm_size;
+      counts[i] = (long) size * (i + 1) / comm_size - displs[i];
+    }
+  int n_local = counts[my_rank];
+  int *a = NULL, *top = NULL, qv[MAX_QUANTILES];
+  int *local = malloc (sizeof (int) * (n_local + 1));
+  if (my_rank == 0)
+    {
+      a = malloc (sizeof (int) * (size + 1));
+      top = malloc (sizeof (int) * (k + 1));
+      if (a == NULL || top == NULL)
+	{
+	  printf ("Error: Could not allocate array of size %d\n", size);
+	  MPI_Abort (MPI_COMM_WORLD, 1);
+	}
+      // Random array initialization
+      srand (314159);
+      for (i = 0; i < size; i++)
+	a[i] = rand () % size;
+    }
+  if (local == NULL)
+    {
+      printf ("Error: Could not allocate array of size %d\n", n_local);
+      MPI_Abort (MPI_COMM_WORLD, 1);
+    }
+  MPI_Barrier (MPI_COMM_WORLD);
+  double start = get_time ();
+  INSTR_START (t_scatter);
+  MPI_Scatterv (a, counts, displs, MPI_INT, local, n_local, MPI_INT, 0,
+		MPI_COMM_WORLD);
+  INSTR_STOP (t_scatter, INSTR_RECV, n_local * sizeof (int));
+  if (!topk_mpi (local, n_local, k, top, MPI_COMM_WORLD))
+    {
+      printf ("Error: Could not allocate top %d\n", k);
+      MPI_Abort (MPI_COMM_WORLD, 1);
+    }
+  for (i = 0; i < n_q && size > 0; i++)
+    {
+      double qi = q[i] < 0.0 ? 0.0 : q[i] > 1.0 ? 1.0 : q[i];
+      qv[i] = select_kth_mpi (local, n_local, (long) (qi * (size - 1)),
+			      MPI_COMM_WORLD);
+    }
+  double end = get_time ();
+  affinity_release ();
+  if (my_rank == 0)
+    {
+      INSTR_RECORD (INSTR_TOTAL, start, end, size * sizeof (int));
+      printf ("Start = %.2f\nEnd = %.2f\nElapsed = %.6f\n",
+	      start, end, end - start);
+      for (i = 0; i < n_q && size > 0; i++)
+	printf ("Quantile %g = %d\n", q[i], qv[i]);
+      // Result check, against a full sort
+      int *temp = malloc (sizeof (int) * (size + 1));
+      if (temp == NULL)
+	{
+	  printf ("Error: Could not allocate array of size %d\n", size);
+	  MPI_Abort (MPI_COMM_WORLD, 1);
+	}
+      mergesort_serial (a, size, temp);
+      for (i = 0; i < k; i++)
+	if (top[i] != a[i])
+	  {
+	    printf ("Implementation error: top[%d]=%d, not %d\n", i,
+		    top[i], a[i]);
+	    MPI_Abort (MPI_COMM_WORLD, 1);
+	  }
+      for (i = 0; i < n_q && size > 0; i++)
+	{
+	  double qi = q[i] < 0.0 ? 0.0 : q[i] > 1.0 ? 1.0 : q[i];
+	  int r = (int) (qi * (size - 1));
+	  if (qv[i] != a[r])
+	    {
+	      printf ("Implementation error: quantile %g = %d, not %d\n",
+		      q[i], qv[i], a[r]);
+	      MPI_Abort (MPI_COMM_WORLD, 1);
+	    }
+	}
+    }
+  fflush (stdout);
+  INSTR_REPORT_MPI ("mpi_select", size, MPI_COMM_WORLD);
+  MPI_Finalize ();
+  return 0;
+}
+
+// Return the K-th smallest (from 0) element over all ranks of COMM,
+// of which this rank holds A[0 .. SIZE - 1].  A is rearranged.
+int
+select_kth_mpi (int a[], int size, long k, MPI_Comm comm)
+{
+  int comm_size, i, lo = 0, hi = size;
+  MPI_Comm_size (comm, &comm_size);
+  struct weighted mine, *medians = malloc (sizeof (*medians) * comm_size);
+  int *counts = malloc (sizeof (int) * comm_size);
+  int *displs = malloc (sizeof (int) * comm_size);
+  for (;;)
+    {
+      long n = hi - lo, total;
+      MPI_Allreduce (&n, &total, 1, MPI_LONG, MPI_SUM, comm);
+      if (total <= GATHER_MAX)
+	break;
+      // Weighted median of the local medians
+      mine.weight = hi - lo;
+      mine.value = n > 0 ? select_kth (a + lo, n, n / 2) : 0;
+      INSTR_START (t_pivot);
+      MPI_Allgather (&mine, 2, MPI_INT, medians, 2, MPI_INT, comm);
+      INSTR_STOP (t_pivot, INSTR_BARRIER, comm_size * sizeof (mine));
+      qsort (medians, comm_size, sizeof (*medians), weighted_less);
+      long below = 0;
+      for (i = 0; i < comm_size; i++)
+	{
+	  below += medians[i].weight;
+	  if (2 * below >= total)
+	    break;
+	}
+      int pivot = medians[i].value;
+      int n_lt, n_eq;
+      select_partition (a + lo, n, pivot, &n_lt, &n_eq);
+      long local[2] = { n_lt, n_eq }, global[2];
+      MPI_Allreduce (local, global, 2, MPI_LONG, MPI_SUM, comm);
+      if (k < global[0])
+	hi = lo + n_lt;
+      else if (k < global[0] + global[1])
+	{
+	  free (medians);
+	  free (counts);
+	  free (displs);
+	  return pivot;
+	}
+      else
+	{
+	  k -= global[0] + global[1];
+	  lo += n_lt + n_eq;
+	}
+    }
+  // Gather the remaining candidates on every rank
+  int n = hi - lo, total = 0, value;
+  MPI_Allgather (&n, 1, MPI_INT, counts, 1, MPI_INT, comm);
+  for (i = 0; i < comm_size; i++)
+    {
+      displs[i] = total;
+      total += counts[i];
+    }
+  int *all = malloc (sizeof (int) * (total + 1));
+  MPI_Allgatherv (a + lo, n, MPI_INT, all, counts, displs, MPI_INT, comm);
+  value = select_kth (all, total, k);
+  free (all);
+  free (medians);
+  free (counts);
+  free (displs);
+  return value;
+}
+
+// Set OUT[0 .. K - 1], on rank 0 of COMM, to the K smallest elements
+// over all ranks, in order.  Returns 0 if out of memory.
+int
+topk_mpi (int a[], int size, int k, int out[], MPI_Comm comm)
+{
+  int comm_size, my_rank, i;
+  MPI_Comm_size (comm, &comm_size);
+  MPI_Comm_rank (comm, &my_rank);
+  if (k <= 0)
+    return 1;
+  int v = select_kth_mpi (a, size, k - 1, comm);
+  // All elements less than V, and the first equal ones by rank
+  int n_lt = 0, n_eq = 0, before = 0, take;
+  for (i = 0; i < size; i++)
+    {
+      n_lt += a[i] < v;
+      n_eq += a[i] == v;
+    }
+  long lt = n_lt, total_lt;
+  MPI_Allreduce (&lt, &total_lt, 1, MPI_LONG, MPI_SUM, comm);
+  MPI_Exscan (&n_eq, &before, 1, MPI_INT, MPI_SUM, comm);
+  if (my_rank == 0)
+    before = 0;
+  take = k - total_lt - before;
+  take = take < 0 ? 0 : take > n_eq ? n_eq : take;
+  int n = n_lt + take, j = 0;
+  int *mine = malloc (sizeof (int) * (n + 1));
+  int *counts = malloc (sizeof (int) * comm_size);
+  int *displs = malloc (sizeof (int) * comm_size);
+  if (mine == NULL || counts == NULL || displs == NULL)
+    {
+      free (mine);
+      free (counts);
+      free (displs);
+      return 0;
+    }
+  for (i = 0; i < size; i++)
+    if (a[i] < v || (a[i] == v && take-- > 0))
+      mine[j++] = a[i];
+  MPI_Gather (&n, 1, MPI_INT, counts, 1, MPI_INT, 0, comm);
+  if (my_rank == 0)
+    for (i = 0; i < comm_size; i++)
+      displs[i] = i > 0 ? displs[i - 1] + counts[i - 1] : 0;
+  INSTR_START (t_gather);
+  MPI_Gatherv (mine, n, MPI_INT, out, counts, displs, MPI_INT, 0, comm);
+  INSTR_STOP (t_gather, INSTR_RECV, n * sizeof (int));
+  if (my_rank == 0)
+    {
+      // Sort the K smallest; MINE is no longer needed.
+      int *temp = malloc (sizeof (int) * k);
+      if (temp == NULL)
+	{
+	  free (mine);
+	  free (counts);
+	  free (displs);
+	  return 0;
+	}
+      INSTR_START (t_leaf);
+      mergesort_serial (out, k, temp);
+      INSTR_STOP (t_leaf, INSTR_LEAF_SORT, k * sizeof (int));
+      free (temp);
+    }
+  free (mine);
+  free (counts);
+  free (displs);
+  return 1;
+}
@@ -0,0 +1,336 @@
+/* Shared memory merge sort engines, as a library.
+   Copyright (C) 2011  Atanas Radenski
+
+   Derived from omp_mergesort.c by Gary Funck <gary@intrepidtechnologyinc.com>
+   Date: 2026-10-19
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+#include <stdlib.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <omp.h>
+#include "instrument.h"
+#include "sort_tune.h"
+#include "msort.h"
+
+// The OpenMP merge sort of omp_mergesort.c: tasks if the host's
+// profile sets a task cutoff, else sections
+void
+run_omp (int a[], int size, int temp[], int threads)
+{
+  // Enable nested parallelism, if available
+  omp_set_nested (1);
+  if (sort_tune.task_cutoff > 0)
+    {
+#pragma omp parallel num_threads (threads)
+#pragma omp single
+      mergesort_tasks_omp (a, size, temp);
+    }
+  else
+    mergesort_parallel_omp (a, size, temp, threads);
+}
+
+// OpenMP merge sort with a task per recursive sort, down to
+// sort_tune.task_cutoff elements
+void
+mergesort_tasks_omp (int a[], int size, int temp[])
+{
+  if (size <= sort_tune.task_cutoff)
+    {
+      INSTR_START (t_leaf);
+      mergesort_serial (a, size, temp);
+      INSTR_STOP (t_leaf, INSTR_LEAF_SORT, size * sizeof (int));
+    }
+  else
+    {
+      INSTR_START (t_sort);
+#pragma omp task
+      mergesort_tasks_omp (a, size / 2, temp);
+      mergesort_tasks_omp (a + size / 2, size - size / 2, temp + size / 2);
+      INSTR_START (t_wait);
+#pragma omp taskwait
+      INSTR_STOP (t_wait, INSTR_BARRIER, 0);
+      // Merge the two sorted sub-arrays through temp
+      INSTR_START (t_merge);
+      merge (a, size, size / 2, temp);
+      INSTR_STOP_MERGE (t_merge, size);
+      INSTR_STOP (t_sort, INSTR_SORT, size * sizeof (int));
+    }
+}
+
+// OpenMP merge sort with given number of threads
+void
+mergesort_parallel_omp (int a[], int size, int temp[], int threads)
+{
+  if (threads == 1)
+    {
+      INSTR_START (t_leaf);
+      mergesort_serial (a, size, temp);
+      INSTR_STOP (t_leaf, INSTR_LEAF_SORT, size * sizeof (int));
+    }
+  else if (threads > 1)
+    {
+      INSTR_START (t_sort);
+      INSTR_DECLARE (t_left_done);
+      INSTR_DECLARE (t_right_done);
+#pragma omp parallel sections
+      {
+#pragma omp section
+	{
+	  mergesort_parallel_omp (a, size / 2, temp, threads / 2);
+	  INSTR_STAMP (t_left_done);
+	}
+#pragma omp section
+	{
+	  mergesort_parallel_omp (a + size / 2, size - size / 2,
+				  temp + size / 2, threads - threads / 2);
+	  INSTR_STAMP (t_right_done);
+	}
+      }
+      INSTR_JOIN_WAIT (t_left_done, t_right_done);
+      // Thread allocation is implementation dependent
+      // Some threads can execute multiple sections while others are idle
+      // Merge the two sorted sub-arrays through temp
+      INSTR_START (t_merge);
+      merge (a, size, size / 2, temp);
+      INSTR_STOP_MERGE (t_merge, size);
+      INSTR_STOP (t_sort, INSTR_SORT, size * sizeof (int));
+    }
+  else
+    {
+      printf ("Error: %d threads\n", threads);
+      return;
+    }
+}
+
+void
+mergesort_serial (int a[], int size, int temp[])
+{
+  // Switch to insertion sort for small arrays
+  if (size <= sort_tune.small)
+    {
+      insertion_sort (a, size);
+      return;
+    }
+  mergesort_serial (a, size / 2, temp);
+  mergesort_serial (a + size / 2, size - size / 2, temp);
+  // Merge the two sorted sub-arrays
+  merge (a, size, size / 2, temp);
+}
+
+void
+merge (int a[], int size, int left_size, int temp[])
+{
+  int i1 = 0;
+  int i2 = left_size;
+  int tempi = 0;
+  while (i1 < left_size && i2 < size)
+    {
+      // Take the left element on a tie, to keep the sort stable
+      if (a[i1] <= a[i2])
+	{
+	  temp[tempi] = a[i1];
+	  i1++;
+	}
+      else
+	{
+	  temp[tempi] = a[i2];
+	  i2++;
+	}
+      tempi++;
+    }
+  while (i1 < left_size)
+    {
+      temp[tempi] = a[i1];
+      i1++;
+      tempi++;
+    }
+  while (i2 < size)
+    {
+      temp[tempi] = a[i2];
+      i2++;
+      tempi++;
+    }
+  // Copy sorted temp array into main array, a
+  memcpy (a, temp, size * sizeof (int));
+}
+
+void
+insertion_sort (int a[], int size)
+{
+  int i;
+  for (i = 0; i < size; i++)
+    {
+      int j, v = a[i];
+      for (j = i - 1; j >= 0; j--)
+	{
+	  if (a[j] <= v)
+	    break;
+	  a[j + 1] = a[j];
+	}
+      a[j + 1] = v;
+    }
+}
+
+// Sort V[0 .. WIDTH - 1] (WIDTH a power of 2) with a bitonic sorting
+// network.  The loops unroll into a fixed sequence of branch-free
+// compare-exchanges (minimum and maximum).
+static inline __attribute__ ((always_inline)) void
+bitonic_sort (int v[], const int width)
+{
+  int i, j, k;
+  for (k = 2; k <= width; k *= 2)
+    for (j = k / 2; j > 0; j /= 2)
+      for (i = 0; i < width; i++)
+	{
+	  // The first step of each merge compares mirror images
+	  int l = (j == k / 2 ? i ^ (k - 1) : i ^ j) & (width - 1);
+	  if (l > i)
+	    {
+	      int lo = v[i] < v[l] ? v[i] : v[l];
+	      int hi = v[i] < v[l] ? v[l] : v[i];
+	      v[i] = lo;
+	      v[l] = hi;
+	    }
+	}
+}
+
+// Sort up to SMALL_SORT_MAX elements: insertion sort for a few, else
+// a sorting network of the next power of 2, on a copy padded with
+// INT_MAX.
+void
+small_sort (int a[], int size)
+{
+  int v[SMALL_SORT_MAX], i;
+  if (size <= 4)
+    {
+      insertion_sort (a, size);
+      return;
+    }
+  for (i = 0; i < SMALL_SORT_MAX; i++)
+    v[i] = i < size ? a[i] : INT_MAX;
+  if (size <= 8)
+    bitonic_sort (v, 8);
+  else
+    bitonic_sort (v, SMALL_SORT_MAX);
+  memcpy (a, v, size * sizeof (int));
+}
+
+// segmented_sort_omp groups consecutive segments into chunks of about
+// SEG_CHUNK elements (at least SEG_CHUNK_MIN), and runs a task per
+// chunk, largest first.  A segment larger than two chunks is itself
+// sorted by tasks.
+#define SEG_CHUNK(total, threads) ((total) / (8 * (threads)))
+#define SEG_CHUNK_MIN 4096
+
+// Segments [first, last)
+struct seg_chunk
+{
+  int first, last;
+  long elements;
+};
+
+static int
+seg_chunk_larger (const void *x, const void *y)
+{
+  long a = ((const struct seg_chunk *) x)->elements;
+  long b = ((const struct seg_chunk *) y)->elements;
+  return (a < b) - (a > b);
+}
+
+static void
+sort_segment (int a[], int size, int temp[])
+{
+  if (size <= SMALL_SORT_MAX)
+    small_sort (a, size);
+  else
+    mergesort_serial (a, size, temp);
+}
+
+// Merge sort with a task per half, down to CUTOFF elements
+static void
+sort_segment_tasks (int a[], int size, int temp[], int cutoff)
+{
+  if (size <= cutoff)
+    mergesort_serial (a, size, temp);
+  else
+    {
+#pragma omp task
+      sort_segment_tasks (a, size / 2, temp, cutoff);
+      sort_segment_tasks (a + size / 2, size - size / 2, temp + size / 2,
+			  cutoff);
+#pragma omp taskwait
+      merge (a, size, size / 2, temp);
+    }
+}
+
+void
+segmented_sort_omp (int a[], const int offsets[], int n_segments,
+		    int temp[], int threads)
+{
+  long total = (long) offsets[n_segments] - offsets[0];
+  long target = SEG_CHUNK (total, threads);
+  struct seg_chunk *chunk = malloc (sizeof (*chunk) * (n_segments + 1));
+  int n_chunks = 0, i, c;
+  if (target < SEG_CHUNK_MIN)
+    target = SEG_CHUNK_MIN;
+  if (chunk == NULL)
+    {
+      for (i = 0; i < n_segments; i++)
+	sort_segment (a + offsets[i], offsets[i + 1] - offsets[i],
+		      temp + offsets[i]);
+      return;
+    }
+  for (i = 0; i < n_segments;)
+    {
+      struct seg_chunk *ch = &chunk[n_chunks++];
+      ch->first = i;
+      ch->elements = 0;
+      do
+	{
+	  ch->elements += offsets[i + 1] - offsets[i];
+	  i++;
+	}
+      while (i < n_segments
+	     && ch->elements + offsets[i + 1] - offsets[i] <= target);
+      ch->last = i;
+    }
+  qsort (chunk, n_chunks, sizeof (*chunk), seg_chunk_larger);
+#pragma omp parallel num_threads (threads)
+#pragma omp single
+  for (c = 0; c < n_chunks; c++)
+    {
+#pragma omp task firstprivate (c) private (i)
+      {
+	INSTR_START (t_leaf);
+	for (i = chunk[c].first; i < chunk[c].last; i++)
+	  {
+	    int size = offsets[i + 1] - offsets[i];
+	    if (size > 2 * target)
+	      sort_segment_tasks (a + offsets[i], size, temp + offsets[i],
+				  target);
+	    else
+	      sort_segment (a + offsets[i], size, temp + offsets[i]);
+	  }
+	INSTR_STOP (t_leaf, INSTR_LEAF_SORT, chunk[c].elements * sizeof (int));
+      }
+    }
+  free (chunk);
+}
@@ -0,0 +1,148 @@
+/* Shared memory merge sort engines, as a library.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef MSORT_H
+#define MSORT_H
+
+#include <stddef.h>
+
+// The serial and OpenMP engines of serial_mergesort.c and
+// omp_mergesort.c, packaged so that the benchmark tools can run
+// them in-process.  The stand-alone drivers keep their own copies.
+
+// The leaf size and the task cutoff are those of sort_tune (see
+// sort_tune.h).
+
+extern void insertion_sort (int a[], int size);
+extern void merge (int a[], int size, int left_size, int temp[]);
+extern void mergesort_serial (int a[], int size, int temp[]);
+// Nested parallelism must be enabled (omp_set_nested (1)) by the
+// caller for THREADS > 2 to use more than two threads.
+extern void mergesort_parallel_omp (int a[], int size, int temp[],
+				    int threads);
+extern void mergesort_tasks_omp (int a[], int size, int temp[]);
+extern void run_omp (int a[], int size, int temp[], int threads);
+
+// Segments of up to SMALL_SORT_MAX elements are sorted by small_sort.
+#define SMALL_SORT_MAX 16
+extern void small_sort (int a[], int size);
+// Sort each of the N_SEGMENTS segments a[offsets[i]] ..
+// a[offsets[i + 1] - 1] on its own, with THREADS threads.  TEMP is
+// as large as A.
+extern void segmented_sort_omp (int a[], const int offsets[],
+				int n_segments, int temp[], int threads);
+
+// msort_natural.c: merge sorts adaptive to the runs in their input
+extern void merge_gallop (int a[], int size, int left_size, int temp[]);
+extern void merge_parallel (int a[], int size, int left_size, int temp[],
+			    int threads);
+extern void natural_mergesort (int a[], int size, int temp[]);
+extern void natural_mergesort_omp (int a[], int size, int temp[],
+				   int threads);
+
+// msort_argsort.c: stable sort of keys, with the sorting permutation
+extern void merge_argsort (int key[], int idx[], int size, int left_size,
+			   int key_temp[], int idx_temp[]);
+extern void argsort_serial (int key[], int idx[], int size, int key_temp[],
+			    int idx_temp[]);
+extern void argsort_omp (int key[], int idx[], int size, int key_temp[],
+			 int idx_temp[], int threads);
+extern void apply_permutation_omp (const int idx[], int size,
+				   const void *src, void *dst,
+				   size_t elem_size, int threads);
+
+// msort_radix.c: radix sorts of int keys.  BITS is 8 or 11.
+extern void radix_lsd_omp (int a[], int size, int temp[], int threads,
+			   int bits);
+extern void radix_msd_omp (int a[], int size, int temp[], int threads);
+
+// msort_select.c: selection without a full sort
+extern void select_partition (int a[], int size, int pivot, int *n_lt,
+			      int *n_eq);
+extern int select_kth (int a[], int size, int k);
+extern int topk_omp (const int a[], int size, int k, int out[], int temp[],
+		     int threads);
+extern int partial_sort_omp (int a[], int size, int k, int temp[],
+			     int threads);
+extern int quantiles_omp (int a[], int size, const double q[], int n_q,
+			  int out[], int threads);
+
+// msort_incremental.c: a sorted array that takes batches of new keys
+#define SORTED_ARRAY_RUNS 64
+struct sorted_array
+{
+  int *a;			// The sorted base
+  int size, capacity;
+  int *pending;			// Sorted runs of keys not yet merged into A
+  int n_pending, pending_capacity;
+  int run_start[SORTED_ARRAY_RUNS];
+  int n_runs;
+  int *temp;
+  int temp_capacity;
+  int threads;
+};
+
+extern struct sorted_array *sorted_array_new (int threads);
+extern void sorted_array_free (struct sorted_array *sa);
+extern int sorted_array_insert (struct sorted_array *sa, int batch[], int n);
+extern int sorted_array_flush (struct sorted_array *sa);
+extern long sorted_array_rank (const struct sorted_array *sa, int key);
+
+// msort_dispatch.c: the engine for the input, by a sample of it
+enum sort_engine
+{
+  SORT_ENGINE_MERGE,		// run_omp
+  SORT_ENGINE_NATURAL,		// natural_mergesort_omp
+  SORT_ENGINE_COUNTING,		// counting_sort_omp
+  SORT_ENGINE_RADIX,		// radix_lsd_omp, 11-bit digits
+  SORT_ENGINE_N
+};
+extern const char *const sort_engine_name[SORT_ENGINE_N];
+
+struct sort_sample
+{
+  int min, max;			// Least and greatest sampled keys
+  double breaks;		// Fraction of keys that end a run
+  double duplicates;		// Fraction of keys repeating an earlier one
+  int uniform;			// Keys spread evenly over min .. max
+};
+
+struct sort_choice
+{
+  enum sort_engine engine;
+  struct sort_sample sample;
+  char reason[160];
+};
+
+extern void sort_sample_omp (const int a[], int size, int threads,
+			     struct sort_sample *s);
+extern int counting_sort_omp (int a[], int size, int lo, int hi, int temp[],
+			      int threads);
+extern void sort_dispatch_omp (int a[], int size, int temp[], int threads,
+			       struct sort_choice *choice);
+
+// msort_group.c: sorts that end in the groups of equal keys
+extern int sort_unique (int a[], int size, int temp[], int threads);
+extern int sort_count (int a[], int size, int temp[], int counts[],
+		       int threads);
+extern int sort_group_offsets (int a[], int size, int temp[], int offsets[],
+			       int threads);
+
+#endif /* MSORT_H */
@@ -0,0 +1,185 @@
+/* Stable key + index merge sort (argsort).
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+// argsort_serial and argsort_omp sort an array of keys and return
+// the permutation that sorts them: IDX[i] is the original position
+// of the key now at KEY[i].  Keys and indices stay in two separate
+// arrays, and every step moves both streams together, so that each
+// is read and written sequentially.  Equal keys keep their original
+// order: the merges take the left element on a tie.
+//
+// apply_permutation_omp then gathers the rows of any payload column
+// into the sorted order.
+
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "instrument.h"
+#include "sort_tune.h"
+#include "msort.h"
+
+// Tasks per thread of argsort_omp
+#define ARG_TASKS_PER_THREAD 4
+
+static void
+insertion_argsort (int key[], int idx[], int size)
+{
+  int i;
+  for (i = 1; i < size; i++)
+    {
+      int j, k = key[i], x = idx[i];
+      for (j = i - 1; j >= 0 && key[j] > k; j--)
+	{
+	  key[j + 1] = key[j];
+	  idx[j + 1] = idx[j];
+	}
+      key[j + 1] = k;
+      idx[j + 1] = x;
+    }
+}
+
+// Stable merge of the two sorted halves of KEY and IDX, through the
+// temporary arrays
+void
+merge_argsort (int key[], int idx[], int size, int left_size,
+	       int key_temp[], int idx_temp[])
+{
+  int i = 0, j = left_size, o = 0;
+  if (left_size == 0 || left_size == size
+      || key[left_size - 1] <= key[left_size])
+    return;
+  while (i < left_size && j < size)
+    {
+      // Branch free; the same choice moves the key and the index.
+      int take_r = key[j] < key[i];
+      key_temp[o] = take_r ? key[j] : key[i];
+      idx_temp[o] = take_r ? idx[j] : idx[i];
+      j += take_r;
+      i += !take_r;
+      o++;
+    }
+  memcpy (key_temp + o, key + i, (left_size - i) * sizeof (int));
+  memcpy (idx_temp + o, idx + i, (left_size - i) * sizeof (int));
+  o += left_size - i;
+  // The rest of the right half is in place.
+  memcpy (key, key_temp, o * sizeof (int));
+  memcpy (idx, idx_temp, o * sizeof (int));
+}
+
+static void
+argsort_rec (int key[], int idx[], int size, int key_temp[], int idx_temp[])
+{
+  if (size <= sort_tune.small)
+    {
+      insertion_argsort (key, idx, size);
+      return;
+    }
+  argsort_rec (key, idx, size / 2, key_temp, idx_temp);
+  argsort_rec (key + size / 2, idx + size / 2, size - size / 2,
+	       key_temp + size / 2, idx_temp + size / 2);
+  merge_argsort (key, idx, size, size / 2, key_temp, idx_temp);
+}
+
+static void
+argsort_tasks (int key[], int idx[], int size, int key_temp[],
+	       int idx_temp[], int cutoff)
+{
+  if (size <= cutoff)
+    {
+      INSTR_START (t_leaf);
+      argsort_rec (key, idx, size, key_temp, idx_temp);
+      INSTR_STOP (t_leaf, INSTR_LEAF_SORT, 2 * size * sizeof (int));
+    }
+  else
+    {
+#pragma omp task
+      argsort_tasks (key, idx, size / 2, key_temp, idx_temp, cutoff);
+      argsort_tasks (key + size / 2, idx + size / 2, size - size / 2,
+		     key_temp + size / 2, idx_temp + size / 2, cutoff);
+#pragma omp taskwait
+      INSTR_START (t_merge);
+      merge_argsort (key, idx, size, size / 2, key_temp, idx_temp);
+      INSTR_STOP_MERGE (t_merge, size);
+    }
+}
+
+// Sort KEY[0 .. SIZE - 1], and set IDX to the sorting permutation.
+// The temporary arrays hold SIZE elements each.
+void
+argsort_serial (int key[], int idx[], int size, int key_temp[],
+		int idx_temp[])
+{
+  int i;
+  for (i = 0; i < size; i++)
+    idx[i] = i;
+  argsort_rec (key, idx, size, key_temp, idx_temp);
+}
+
+// argsort_serial, with a task per recursive sort down to a share of
+// SIZE / (ARG_TASKS_PER_THREAD * THREADS) elements
+void
+argsort_omp (int key[], int idx[], int size, int key_temp[], int idx_temp[],
+	     int threads)
+{
+  int i, cutoff = size / (ARG_TASKS_PER_THREAD * threads);
+  if (cutoff < sort_tune.small)
+    cutoff = sort_tune.small;
+#pragma omp parallel num_threads (threads)
+  {
+#pragma omp for schedule (static)
+    for (i = 0; i < size; i++)
+      idx[i] = i;
+#pragma omp single
+    argsort_tasks (key, idx, size, key_temp, idx_temp, cutoff);
+  }
+}
+
+// DST[i] = SRC[IDX[i]], for SIZE elements of ELEM_SIZE bytes
+void
+apply_permutation_omp (const int idx[], int size, const void *src,
+		       void *dst, size_t elem_size, int threads)
+{
+  int i;
+  if (elem_size == sizeof (int))
+    {
+      const int *s = src;
+      int *d = dst;
+#pragma omp parallel for num_threads (threads) schedule (static)
+      for (i = 0; i < size; i++)
+	d[i] = s[idx[i]];
+    }
+  else if (elem_size == sizeof (double))
+    {
+      const double *s = src;
+      double *d = dst;
+#pragma omp parallel for num_threads (threads) schedule (static)
+      for (i = 0; i < size; i++)
+	d[i] = s[idx[i]];
+    }
+  else
+    {
+      const char *s = src;
+      char *d = dst;
+#pragma omp parallel for num_threads (threads) schedule (static)
+      for (i = 0; i < size; i++)
+	memcpy (d + (size_t) i * elem_size,
+		s + (size_t) idx[i] * elem_size, elem_size);
+    }
+}
@@ -0,0 +1,309 @@
+/* Choice of sort engine by a sample of the input.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+// sort_dispatch_omp looks at DISPATCH_SAMPLE keys of its input,
+// spread over the array and taken by all threads, and estimates:
+//
+//   the key range    the least and greatest sampled keys;
+//   presortedness    the fraction of sampled keys at which the order
+//                    of an ascending or descending run turns, as
+//                    natural_mergesort finds runs: one over the mean
+//                    run length;
+//   duplicates       the fraction of keys that repeat an earlier key:
+//                    for presorted keys, that of the sampled pairs
+//                    that are equal; for uniform keys, that expected
+//                    of SIZE random draws from the range; else that
+//                    of the sample;
+//   uniformity       whether each of DISPATCH_BUCKETS equal parts of
+//                    the range holds a fair share of the sample.
+//
+// and then sorts with the first engine that fits:
+//
+//   natural_mergesort_omp  sorted, or nearly: a mean run of at least
+//                          DISPATCH_RUN_SORTED keys
+//   counting_sort_omp      a range small enough for a count per key
+//                          and thread to fit in TEMP, at most a
+//                          quarter of SIZE
+//   radix_lsd_omp          uniform keys over a range of at least
+//                          DISPATCH_RADIX_RANGE
+//   natural_mergesort_omp  presorted: a mean run of at least
+//                          DISPATCH_RUN_MIN keys
+//   run_omp                anything else, and inputs of fewer than
+//                          DISPATCH_MIN keys
+//
+// The radix sort takes a few passes over any input, so it beats the
+// natural merge sort unless nearly all of the input is in runs.
+//
+// The sampled range is only an estimate: counting_sort_omp gives up,
+// having only read the array, if a key falls outside it, and the
+// merge sort runs instead.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "msort.h"
+
+// Keys sampled
+#define DISPATCH_SAMPLE 4096
+// Inputs below this size go to the merge sort unsampled.
+#define DISPATCH_MIN 65536
+// Presorted: a mean run of at least this many keys; and so much so
+// that the natural merge sort beats the radix sort
+#define DISPATCH_RUN_MIN 16
+#define DISPATCH_RUN_SORTED 256
+// Uniformity test: parts of the range, and how far from its share
+// of the sample each part may be (a factor of 2)
+#define DISPATCH_BUCKETS 16
+// Least range for the radix sort
+#define DISPATCH_RADIX_RANGE 65536
+
+const char *const sort_engine_name[SORT_ENGINE_N] = {
+  "omp_mergesort", "omp_natural_mergesort", "omp_counting_sort",
+  "omp_lsd_radix11"
+};
+
+static int
+compare_int (const void *x, const void *y)
+{
+  int a = *(const int *) x, b = *(const int *) y;
+  return a < b ? -1 : a > b;
+}
+
+// Estimate the key range, presortedness, duplicates and uniformity
+// of A[0 .. SIZE - 1] from a sample of DISPATCH_SAMPLE keys, with
+// THREADS threads.
+void
+sort_sample_omp (const int a[], int size, int threads, struct sort_sample *s)
+{
+  int sample[DISPATCH_SAMPLE];
+  int n = size - 2 < DISPATCH_SAMPLE ? size - 2 : DISPATCH_SAMPLE;
+  int turns = 0, equal = 0, i;
+  memset (s, 0, sizeof (*s));
+  if (size < 3)
+    {
+      for (i = 0; i < size; i++)
+	{
+	  if (i == 0 || a[i] < s->min)
+	    s->min = a[i];
+	  if (i == 0 || a[i] > s->max)
+	    s->max = a[i];
+	}
+      return;
+    }
+  // Sample I is at a pseudo-random place in the Ith of N equal
+  // strides of the array, and is compared with the two keys after
+  // it: the order turns if one pair ascends and the other descends.
+#pragma omp parallel for num_threads (threads) schedule (static) \
+  reduction (+:turns, equal)
+  for (i = 0; i < n; i++)
+    {
+      long lo = (long) (size - 2) * i / n;
+      long hi = (long) (size - 2) * (i + 1) / n;
+      unsigned int h = (unsigned int) i * 2654435761u;
+      long j = lo + (hi > lo ? (h >> 8) % (hi - lo) : 0);
+      int d1 = (a[j] < a[j + 1]) - (a[j] > a[j + 1]);
+      int d2 = (a[j + 1] < a[j + 2]) - (a[j + 1] > a[j + 2]);
+      sample[i] = a[j];
+      turns += d1 * d2 < 0;
+      equal += d1 == 0;
+    }
+  qsort (sample, n, sizeof (int), compare_int);
+  s->min = sample[0];
+  s->max = sample[n - 1];
+  s->breaks = (double) turns / n;
+  // Uniformity
+  long range = (long) s->max - s->min + 1;
+  int count[DISPATCH_BUCKETS] = { 0 };
+  for (i = 0; i < n; i++)
+    count[(long) ((long) sample[i] - s->min) * DISPATCH_BUCKETS / range]++;
+  s->uniform = range >= DISPATCH_BUCKETS;
+  for (i = 0; i < DISPATCH_BUCKETS; i++)
+    if (count[i] * DISPATCH_BUCKETS * 2 < n
+	|| count[i] * DISPATCH_BUCKETS > 2 * n)
+      s->uniform = 0;
+  // Duplicates
+  int distinct = 1;
+  for (i = 1; i < n; i++)
+    distinct += sample[i] != sample[i - 1];
+  if (s->breaks * DISPATCH_RUN_MIN <= 1)
+    // Runs of keys: duplicates are next to each other.
+    s->duplicates = (double) equal / n;
+  else if (s->uniform)
+    // SIZE draws from RANGE keys take RANGE (1 - e^(-SIZE / RANGE))
+    // distinct keys, on average.
+    s->duplicates =
+      1.0 - (double) range / size * (1.0 - exp (-(double) size / range));
+  else
+    s->duplicates = 1.0 - (double) distinct / n;
+}
+
+// Sort A[0 .. SIZE - 1], all of whose keys are within LO .. HI, by
+// counting, with THREADS threads.  TEMP holds the counts of each of
+// THREADS slices of A, and must have room for (HI - LO + 1) * THREADS
+// of them.
+// Returns 0, with A unchanged, if a key is out of range.
+int
+counting_sort_omp (int a[], int size, int lo, int hi, int temp[],
+		   int threads)
+{
+  const long range = (long) hi - lo + 1;
+  long part[threads + 1];
+  int bad = 0, t;
+  // THREADS slices of A and of the range, whatever the size of the
+  // team
+#pragma omp parallel for num_threads (threads) schedule (static) \
+  reduction (|:bad)
+  for (t = 0; t < threads; t++)
+    {
+      int i0 = (long) size * t / threads, i1 = (long) size * (t + 1) / threads;
+      int *count = temp + range * t, i;
+      memset (count, 0, range * sizeof (int));
+      for (i = i0; i < i1; i++)
+	{
+	  long k = (long) a[i] - lo;
+	  if (k < 0 || k >= range)
+	    {
+	      bad = 1;
+	      break;
+	    }
+	  count[k]++;
+	}
+    }
+  if (bad)
+    return 0;
+  // Each part of the range has the counts of all slices totalled into
+  // those of slice 0, then, once the parts have been placed, its keys
+  // written out.
+#pragma omp parallel num_threads (threads)
+  {
+    int u;
+#pragma omp for schedule (static)
+    for (t = 0; t < threads; t++)
+      {
+	long k0 = range * t / threads, k1 = range * (t + 1) / threads, k;
+	long sum = 0;
+	for (k = k0; k < k1; k++)
+	  {
+	    for (u = 1; u < threads; u++)
+	      temp[k] += temp[range * u + k];
+	    sum += temp[k];
+	  }
+	part[t + 1] = sum;
+      }
+#pragma omp single
+    {
+      part[0] = 0;
+      for (u = 1; u <= threads; u++)
+	part[u] += part[u - 1];
+    }
+#pragma omp for schedule (static)
+    for (t = 0; t < threads; t++)
+      {
+	long k0 = range * t / threads, k1 = range * (t + 1) / threads, k;
+	int *out = a + part[t];
+	for (k = k0; k < k1; k++)
+	  {
+	    int key = lo + k, n = temp[k];
+	    while (n-- > 0)
+	      *out++ = key;
+	  }
+      }
+  }
+  return 1;
+}
+
+// Sort A[0 .. SIZE - 1] through TEMP, as large, with THREADS threads,
+// by the engine that a sample of A suggests.  If CHOICE is not NULL,
+// it is set to the engine, the sample and the reason.
+void
+sort_dispatch_omp (int a[], int size, int temp[], int threads,
+		   struct sort_choice *choice)
+{
+  struct sort_choice c;
+  memset (&c, 0, sizeof (c));
+  if (size < DISPATCH_MIN)
+    {
+      c.engine = SORT_ENGINE_MERGE;
+      snprintf (c.reason, sizeof (c.reason), "%d keys, too few to sample",
+		size);
+    }
+  else
+    {
+      sort_sample_omp (a, size, threads, &c.sample);
+      const struct sort_sample *s = &c.sample;
+      long range = (long) s->max - s->min + 1;
+      int n = snprintf (c.reason, sizeof (c.reason),
+			"range %ld, %.0f%% duplicates, %.1f%% run breaks%s",
+			range, 100 * s->duplicates, 100 * s->breaks,
+			s->uniform ? ", uniform" : "");
+      const char *why = "";
+      if (s->breaks * DISPATCH_RUN_SORTED <= 1)
+	{
+	  c.engine = SORT_ENGINE_NATURAL;
+	  why = "sorted runs";
+	}
+      else if (range * threads <= size && range * 4 <= size)
+	{
+	  c.engine = SORT_ENGINE_COUNTING;
+	  why = "small key range";
+	}
+      else if (s->uniform && range >= DISPATCH_RADIX_RANGE)
+	{
+	  c.engine = SORT_ENGINE_RADIX;
+	  why = "wide uniform keys";
+	}
+      else if (s->breaks * DISPATCH_RUN_MIN <= 1)
+	{
+	  c.engine = SORT_ENGINE_NATURAL;
+	  why = "presorted";
+	}
+      else
+	{
+	  c.engine = SORT_ENGINE_MERGE;
+	  why = "no special structure";
+	}
+      snprintf (c.reason + n, sizeof (c.reason) - n, ": %s", why);
+    }
+  switch (c.engine)
+    {
+    case SORT_ENGINE_NATURAL:
+      natural_mergesort_omp (a, size, temp, threads);
+      break;
+    case SORT_ENGINE_COUNTING:
+      if (counting_sort_omp (a, size, c.sample.min, c.sample.max, temp,
+			     threads))
+	break;
+      c.engine = SORT_ENGINE_MERGE;
+      strncat (c.reason, ", but keys outside it",
+	       sizeof (c.reason) - strlen (c.reason) - 1);
+      run_omp (a, size, temp, threads);
+      break;
+    case SORT_ENGINE_RADIX:
+      radix_lsd_omp (a, size, temp, threads, 11);
+      break;
+    default:
+      run_omp (a, size, temp, threads);
+      break;
+    }
+  if (choice != NULL)
+    *choice = c;
+}
@@ -0,0 +1,81 @@
+/* Sorts fused with the grouping of equal keys.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+// Sorts that end in the groups of equal keys, rather than the keys:
+// sort_unique, sort_count and sort_group_offsets sort the two halves
+// of the array as mergesort_parallel_omp does, then merge them with
+// merge_groups, which finds the groups in the copy back from TEMP,
+// without another pass over the sorted array.
+
+#include <omp.h>
+#include "sort_group.h"
+#include "msort.h"
+
+// Sort the halves of A[0 .. SIZE - 1] through TEMP with THREADS
+// threads, and merge them into groups, as merge_groups.
+static int
+sort_groups (int a[], int size, int temp[], int counts[], int offsets[],
+	     int threads)
+{
+  if (threads < 2)
+    {
+      mergesort_serial (a, size / 2, temp);
+      mergesort_serial (a + size / 2, size - size / 2, temp + size / 2);
+    }
+  else
+    {
+      omp_set_nested (1);
+#pragma omp parallel sections
+      {
+#pragma omp section
+	mergesort_parallel_omp (a, size / 2, temp, threads / 2);
+#pragma omp section
+	mergesort_parallel_omp (a + size / 2, size - size / 2,
+				temp + size / 2, threads - threads / 2);
+      }
+    }
+  return merge_groups (a, size, size / 2, temp, counts, offsets, threads);
+}
+
+// Sort A[0 .. SIZE - 1] through TEMP, as large, with THREADS threads,
+// leaving its distinct keys in A[0 .. G - 1]; returns G.
+int
+sort_unique (int a[], int size, int temp[], int threads)
+{
+  return sort_groups (a, size, temp, NULL, NULL, threads);
+}
+
+// As sort_unique, and set COUNTS[0 .. G - 1] to the number of each
+// key in the input.
+int
+sort_count (int a[], int size, int temp[], int counts[], int threads)
+{
+  return sort_groups (a, size, temp, counts, NULL, threads);
+}
+
+// Sort A[0 .. SIZE - 1] through TEMP, as large, with THREADS threads,
+// and set OFFSETS[0 .. G] to the offset of each of its G groups of
+// equal keys, then SIZE; returns G.
+int
+sort_group_offsets (int a[], int size, int temp[], int offsets[],
+		    int threads)
+{
+  return sort_groups (a, size, temp, NULL, offsets, threads);
+}
@@ -0,0 +1,178 @@
+/* Incremental merge of sorted batches into a sorted array.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+// A sorted_array keeps a large sorted base array, and takes batches
+// of new keys.  Each batch is sorted (natural_mergesort_omp) and
+// pushed as a run onto a side buffer, of at most 1 / 2^PENDING_SHIFT
+// of the base; adjacent runs are merged as a binary counter carries,
+// so that each run is at least twice the length of the next, and a
+// key is merged O(log (buffer / batch)) times within the buffer.
+// Only when the buffer would overflow is it merged into the base:
+// that merge costs time in proportion to the base, but comes once
+// per 1 / 2^PENDING_SHIFT of the base inserted, or about
+// 2^PENDING_SHIFT moves per key.  So the cost of a batch tracks its
+// size rather than the size of the base.  All merges are
+// merge_parallel's: co-ranked over the threads, and moving only the
+// elements out of place, so that keys that arrive in order cost
+// little more than an append.
+//
+// Readers see the base and the runs together through
+// sorted_array_rank, or flush the buffer to read the base alone.
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "msort.h"
+
+#define PENDING_SHIFT 4
+#define PENDING_MIN 4096
+
+// Grow *P, of *CAPACITY elements, to at least N.  Returns 0 if out of
+// memory.
+static int
+reserve (int **p, int *capacity, long n)
+{
+  if (n <= *capacity)
+    return 1;
+  long c = *capacity ? *capacity : PENDING_MIN;
+  while (c < n)
+    c *= 2;
+  if (c > INT_MAX)
+    c = n;
+  int *q = realloc (*p, sizeof (int) * c);
+  if (q == NULL)
+    return 0;
+  *p = q;
+  *capacity = c;
+  return 1;
+}
+
+struct sorted_array *
+sorted_array_new (int threads)
+{
+  struct sorted_array *sa = calloc (1, sizeof (*sa));
+  if (sa != NULL)
+    sa->threads = threads;
+  return sa;
+}
+
+void
+sorted_array_free (struct sorted_array *sa)
+{
+  if (sa == NULL)
+    return;
+  free (sa->a);
+  free (sa->pending);
+  free (sa->temp);
+  free (sa);
+}
+
+static int
+run_length (const struct sorted_array *sa, int run)
+{
+  int end = run + 1 < sa->n_runs ? sa->run_start[run + 1] : sa->n_pending;
+  return end - sa->run_start[run];
+}
+
+// Merge the last two runs of the side buffer; TEMP is large enough.
+static void
+merge_last_runs (struct sorted_array *sa)
+{
+  int left = sa->run_start[sa->n_runs - 2];
+  int mid = sa->run_start[sa->n_runs - 1];
+  merge_parallel (sa->pending + left, sa->n_pending - left, mid - left,
+		  sa->temp, sa->threads);
+  sa->n_runs--;
+}
+
+// Merge the side buffer into the base.  Returns 0 if out of memory.
+int
+sorted_array_flush (struct sorted_array *sa)
+{
+  long n = (long) sa->size + sa->n_pending;
+  if (sa->n_pending == 0)
+    return 1;
+  if (!reserve (&sa->a, &sa->capacity, n)
+      || !reserve (&sa->temp, &sa->temp_capacity, n))
+    return 0;
+  while (sa->n_runs > 1)
+    merge_last_runs (sa);
+  memcpy (sa->a + sa->size, sa->pending, sa->n_pending * sizeof (int));
+  merge_parallel (sa->a, n, sa->size, sa->temp, sa->threads);
+  sa->size = n;
+  sa->n_pending = 0;
+  sa->n_runs = 0;
+  return 1;
+}
+
+// Add the N keys of BATCH, which is left sorted.  Returns 0 if out of
+// memory.
+int
+sorted_array_insert (struct sorted_array *sa, int batch[], int n)
+{
+  long pending = (long) sa->n_pending + n;
+  long limit = sa->size >> PENDING_SHIFT;
+  if (n <= 0)
+    return 1;
+  if (!reserve (&sa->temp, &sa->temp_capacity, n)
+      || !reserve (&sa->pending, &sa->pending_capacity, pending))
+    return 0;
+  natural_mergesort_omp (batch, n, sa->temp, sa->threads);
+  if (!reserve (&sa->temp, &sa->temp_capacity, pending))
+    return 0;
+  memcpy (sa->pending + sa->n_pending, batch, n * sizeof (int));
+  sa->run_start[sa->n_runs++] = sa->n_pending;
+  sa->n_pending = pending;
+  while (sa->n_runs > 1
+	 && run_length (sa, sa->n_runs - 2)
+	 < 2 * run_length (sa, sa->n_runs - 1))
+    merge_last_runs (sa);
+  if (pending > (limit > PENDING_MIN ? limit : PENDING_MIN))
+    return sorted_array_flush (sa);
+  return 1;
+}
+
+// Number of elements of A[0 .. N - 1] less than KEY
+static long
+lower_bound (const int a[], int n, int key)
+{
+  int lo = 0, hi = n;
+  while (lo < hi)
+    {
+      int mid = lo + (hi - lo) / 2;
+      if (a[mid] < key)
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+  return lo;
+}
+
+// Number of keys less than KEY, in the base and the side buffer
+long
+sorted_array_rank (const struct sorted_array *sa, int key)
+{
+  long rank = lower_bound (sa->a, sa->size, key);
+  int i;
+  for (i = 0; i < sa->n_runs; i++)
+    rank += lower_bound (sa->pending + sa->run_start[i],
+			 run_length (sa, i), key);
+  return rank;
+}
@@ -0,0 +1,325 @@
+/* Adaptive (natural) merge sort engines.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+// natural_mergesort merges the runs already present in its input,
+// as powersort does: it scans for ascending and strictly descending
+// runs (reversing the latter), extends runs shorter than
+// sort_tune.small with insertion sort, and merges adjacent runs as
+// the powers of their boundaries dictate.  Merges first skip the
+// elements already in place, then gallop over long stretches taken
+// from one side, so that sorted and reverse sorted input take linear
+// time.
+//
+// natural_mergesort_omp runs natural_mergesort on a slice per
+// thread, then merges the slices pairwise; each merge is split among
+// all the threads by co-ranking.
+
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "instrument.h"
+#include "sort_tune.h"
+#include "msort.h"
+
+// A merge gallops when the next GALLOP + 1 elements of one side all
+// come before the head of the other.
+#define GALLOP 8
+
+// Take the lesser head of a merge, without a branch, as the winner
+// is unpredictable on random input.
+#define MERGE_STEP()			\
+  do					\
+    {					\
+      int take_r = *r < *l;		\
+      *out++ = take_r ? *r : *l;	\
+      r += take_r;			\
+      l += !take_r;			\
+    }					\
+  while (0)
+
+// Smaller merges are not split among threads.
+#define PARALLEL_MERGE_MIN 16384
+
+// Deep enough for the powers of 2^64 elements
+#define MAX_RUNS 128
+
+struct run
+{
+  int start, len;
+  int power;			// Of the boundary with the next run
+};
+
+// Number of the N elements of sorted B that are less than KEY, or if
+// AFTER_EQUAL, at most KEY: an exponential, then a binary, search.
+static int
+gallop (int key, const int b[], int n, int after_equal)
+{
+  int lo = 0, step = 1, hi;
+#define BEFORE(x) (after_equal ? (x) <= key : (x) < key)
+  while (lo + step <= n && BEFORE (b[lo + step - 1]))
+    {
+      lo += step;
+      step *= 2;
+    }
+  hi = lo + step - 1 < n ? lo + step - 1 : n;
+  while (lo < hi)
+    {
+      int mid = lo + (hi - lo) / 2;
+      if (BEFORE (b[mid]))
+	lo = mid + 1;
+      else
+	hi = mid;
+    }
+#undef BEFORE
+  return lo;
+}
+
+// Stable merge of the sorted A[0 .. LEFT_SIZE - 1] and
+// A[LEFT_SIZE .. SIZE - 1], through TEMP, with galloping.
+void
+merge_gallop (int a[], int size, int left_size, int temp[])
+{
+  int *right = a + left_size, right_size = size - left_size;
+  if (left_size == 0 || right_size == 0 || a[left_size - 1] <= right[0])
+    return;
+  // Left elements before the first right one, and right elements
+  // after the last left one, are in place already.
+  int k = gallop (right[0], a, left_size, 1);
+  right_size = gallop (a[left_size - 1], right, right_size, 0);
+  int *l = temp, *l_end = temp + (left_size - k);
+  int *r = right, *r_end = right + right_size;
+  int *out = a + k;
+  int i, n;
+  memcpy (temp, a + k, (left_size - k) * sizeof (int));
+  while (l_end - l > GALLOP && r_end - r > GALLOP)
+    {
+      // Gallop, or else merge GALLOP elements.
+      if (l[GALLOP] <= *r)
+	{
+	  n = gallop (*r, l, l_end - l, 1);
+	  memcpy (out, l, n * sizeof (int));
+	  out += n;
+	  l += n;
+	}
+      else if (r[GALLOP] < *l)
+	{
+	  n = gallop (*l, r, r_end - r, 0);
+	  memmove (out, r, n * sizeof (int));
+	  out += n;
+	  r += n;
+	}
+      else
+	for (i = 0; i < GALLOP; i++)
+	  MERGE_STEP ();
+    }
+  while (l < l_end && r < r_end)
+    MERGE_STEP ();
+  // What is left of the right run is in place.
+  memcpy (out, l, (l_end - l) * sizeof (int));
+}
+
+// Length of the run at A[0 .. SIZE - 1], made ascending.
+static int
+find_run (int a[], int size)
+{
+  int n = 1;
+  if (size < 2)
+    return size;
+  if (a[1] < a[0])
+    {
+      while (n < size && a[n] < a[n - 1])
+	n++;
+      // Strictly descending, so reversing it keeps the sort stable
+      int i, j;
+      for (i = 0, j = n - 1; i < j; i++, j--)
+	{
+	  int t = a[i];
+	  a[i] = a[j];
+	  a[j] = t;
+	}
+    }
+  else
+    while (n < size && a[n] >= a[n - 1])
+      n++;
+  return n;
+}
+
+// Powersort's power of the boundary between the runs [S1, S1 + N1)
+// and [S1 + N1, S1 + N1 + N2) of an array of N elements: the first
+// bit at which the binary fractions of their midpoints, over N,
+// differ.
+static int
+node_power (long s1, long n1, long n2, long n)
+{
+  long x = 2 * s1 + n1;		// Twice the midpoints
+  long y = x + n1 + n2;
+  int power = 0;
+  for (;;)
+    {
+      power++;
+      if (x >= n)
+	{
+	  x -= n;
+	  y -= n;
+	}
+      else if (y >= n)
+	break;
+      x <<= 1;
+      y <<= 1;
+    }
+  return power;
+}
+
+void
+natural_mergesort (int a[], int size, int temp[])
+{
+  struct run stack[MAX_RUNS];
+  int n_runs = 0, start = 0;
+  while (start < size)
+    {
+      int len = find_run (a + start, size - start);
+      // Extend short runs
+      if (len < sort_tune.small && start + len < size)
+	{
+	  len = size - start < sort_tune.small ? size - start
+	    : sort_tune.small;
+	  insertion_sort (a + start, len);
+	}
+      if (n_runs > 0)
+	{
+	  struct run *top = &stack[n_runs - 1];
+	  int power = node_power (top->start, top->len, len, size);
+	  while (n_runs > 1 && stack[n_runs - 2].power > power)
+	    {
+	      struct run *x = &stack[n_runs - 2], *y = &stack[n_runs - 1];
+	      merge_gallop (a + x->start, x->len + y->len, x->len, temp);
+	      x->len += y->len;
+	      n_runs--;
+	    }
+	  stack[n_runs - 1].power = power;
+	}
+      stack[n_runs].start = start;
+      stack[n_runs].len = len;
+      n_runs++;
+      start += len;
+    }
+  while (n_runs > 1)
+    {
+      struct run *x = &stack[n_runs - 2], *y = &stack[n_runs - 1];
+      merge_gallop (a + x->start, x->len + y->len, x->len, temp);
+      x->len += y->len;
+      n_runs--;
+    }
+}
+
+// Elements of X among the first K of the stable merge of X[0 .. M - 1]
+// and Y[0 .. N - 1]
+static int
+co_rank (int k, const int x[], int m, const int y[], int n)
+{
+  int lo = k > n ? k - n : 0, hi = k < m ? k : m;
+  while (lo < hi)
+    {
+      int i = lo + (hi - lo) / 2;
+      if (x[i] <= y[k - i - 1])
+	lo = i + 1;
+      else
+	hi = i;
+    }
+  return lo;
+}
+
+static void
+merge_into (const int x[], int m, const int y[], int n, int out[])
+{
+  const int *l = x, *l_end = x + m, *r = y, *r_end = y + n;
+  while (l < l_end && r < r_end)
+    MERGE_STEP ();
+  memcpy (out, l, (l_end - l) * sizeof (int));
+  memcpy (out + (l_end - l), r, (r_end - r) * sizeof (int));
+}
+
+// merge_gallop's merge with THREADS threads, each of which merges
+// an equal share of the output, found by co-ranking, into TEMP.
+// Only the elements out of place are moved, so appending a few
+// larger elements to a long run costs little.
+void
+merge_parallel (int a[], int size, int left_size, int temp[], int threads)
+{
+  int *right = a + left_size, right_size = size - left_size;
+  if (left_size == 0 || right_size == 0 || a[left_size - 1] <= right[0])
+    return;
+  // As merge_gallop, merge only the elements out of place.
+  int k = gallop (right[0], a, left_size, 1);
+  right_size = gallop (a[left_size - 1], right, right_size, 0);
+  a += k;
+  left_size -= k;
+  size = left_size + right_size;
+  if (threads < 2 || size < PARALLEL_MERGE_MIN)
+    {
+      merge_gallop (a, size, left_size, temp);
+      return;
+    }
+#pragma omp parallel num_threads (threads)
+  {
+    int t = omp_get_thread_num (), n = omp_get_num_threads ();
+    int k0 = (long) size * t / n, k1 = (long) size * (t + 1) / n;
+    int i0 = co_rank (k0, a, left_size, right, right_size);
+    int i1 = co_rank (k1, a, left_size, right, right_size);
+    merge_into (a + i0, i1 - i0, right + k0 - i0, (k1 - i1) - (k0 - i0),
+		temp + k0);
+#pragma omp barrier
+    memcpy (a + k0, temp + k0, (k1 - k0) * sizeof (int));
+  }
+}
+
+void
+natural_mergesort_omp (int a[], int size, int temp[], int threads)
+{
+  int *bound = malloc (sizeof (int) * (threads + 1));
+  int t, width;
+  if (threads < 2 || size < threads * sort_tune.small || bound == NULL)
+    {
+      free (bound);
+      natural_mergesort (a, size, temp);
+      return;
+    }
+  for (t = 0; t <= threads; t++)
+    bound[t] = (long) size * t / threads;
+#pragma omp parallel for num_threads (threads) schedule (static, 1)
+  for (t = 0; t < threads; t++)
+    {
+      INSTR_START (t_leaf);
+      natural_mergesort (a + bound[t], bound[t + 1] - bound[t],
+			 temp + bound[t]);
+      INSTR_STOP (t_leaf, INSTR_LEAF_SORT,
+		  (bound[t + 1] - bound[t]) * sizeof (int));
+    }
+  for (width = 1; width < threads; width *= 2)
+    for (t = 0; t + width < threads; t += 2 * width)
+      {
+	int lo = bound[t], mid = bound[t + width];
+	int hi = bound[t + 2 * width < threads ? t + 2 * width : threads];
+	INSTR_START (t_merge);
+	merge_parallel (a + lo, hi - lo, mid - lo, temp + lo, threads);
+	INSTR_STOP_MERGE (t_merge, hi - lo);
+      }
+  free (bound);
+}
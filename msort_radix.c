@@ -0,0 +1,270 @@
+/* Parallel radix sort engines for int keys.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+// Keys are compared as unsigned after their sign bit is flipped, so
+// that negative keys sort first.
+//
+// radix_lsd_omp sorts by BITS-bit digits (8 or 11: 4 or 3 passes),
+// least significant first.  In each pass every thread counts the
+// digits of its slice; the per-thread counts, in digit then thread
+// order, give each thread its place in each bucket, so the scatter
+// is stable and needs no locks.  Each thread stages the keys of
+// each bucket in a 64-byte write-combining buffer, and writes them
+// out a buffer at a time, so that the scatter writes whole cache
+// lines rather than single keys to BUCKETS places at once.  A pass
+// in which all keys have the same digit is skipped.
+//
+// radix_msd_omp sorts by 8-bit digits, most significant first: one
+// parallel pass as above, then the threads share out the buckets,
+// each sorted serially by the next digits, and by mergesort_serial
+// once it holds at most MSD_SMALL keys.
+
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "instrument.h"
+#include "msort.h"
+
+// Keys per write-combining buffer: a 64-byte cache line
+#define WC_KEYS 16
+
+#define MSD_BITS 8
+#define MSD_SMALL 2048
+
+#define DIGIT(x, shift, mask) \
+  ((((unsigned int) (x) ^ 0x80000000u) >> (shift)) & (mask))
+
+// Per-thread state of a pass
+struct radix_scratch
+{
+  int threads, buckets;
+  long *count;			// [threads][buckets]
+  int *wc;			// [threads][buckets][WC_KEYS]
+  unsigned char *fill;		// [threads][buckets], keys in each WC buffer
+};
+
+static int
+radix_scratch_init (struct radix_scratch *s, int threads, int bits)
+{
+  s->threads = threads;
+  s->buckets = 1 << bits;
+  s->count = malloc (sizeof (long) * threads * s->buckets);
+  s->wc = malloc (sizeof (int) * threads * s->buckets * WC_KEYS);
+  s->fill = malloc (threads * s->buckets);
+  return s->count != NULL && s->wc != NULL && s->fill != NULL;
+}
+
+static void
+radix_scratch_free (struct radix_scratch *s)
+{
+  free (s->count);
+  free (s->wc);
+  free (s->fill);
+}
+
+// Scatter SRC[0 .. SIZE - 1] into DST, stably, by the digit at SHIFT.
+// Returns 0, and leaves DST unset, if all keys have the same digit.
+// If BUCKET is not NULL, it is set to the start of each bucket.
+static int
+radix_pass_omp (const int src[], int dst[], int size, int shift,
+		struct radix_scratch *s, long bucket[])
+{
+  const int threads = s->threads, buckets = s->buckets;
+  const unsigned int mask = buckets - 1;
+  int t, d, skip = 0;
+  // THREADS slices, whatever the size of the team
+#pragma omp parallel for num_threads (threads) schedule (static)
+  for (t = 0; t < threads; t++)
+    {
+      int lo = (long) size * t / threads, hi = (long) size * (t + 1) / threads;
+      long *count = s->count + (long) t * buckets;
+      int i;
+      memset (count, 0, buckets * sizeof (long));
+      for (i = lo; i < hi; i++)
+	count[DIGIT (src[i], shift, mask)]++;
+    }
+  // Exclusive prefix sum, in digit then thread order
+  long offset = 0;
+  for (d = 0; d < buckets; d++)
+    {
+      long start = offset;
+      if (bucket != NULL)
+	bucket[d] = start;
+      for (t = 0; t < threads; t++)
+	{
+	  long n = s->count[(long) t * buckets + d];
+	  s->count[(long) t * buckets + d] = offset;
+	  offset += n;
+	}
+      skip |= offset - start == size;
+    }
+  if (skip)
+    return 0;
+#pragma omp parallel for num_threads (threads) schedule (static)
+  for (t = 0; t < threads; t++)
+    {
+      int lo = (long) size * t / threads, hi = (long) size * (t + 1) / threads;
+      long *next = s->count + (long) t * buckets;
+      int *wc = s->wc + (long) t * buckets * WC_KEYS;
+      unsigned char *fill = s->fill + (long) t * buckets;
+      int i, dg;
+      INSTR_START (t_scatter);
+      memset (fill, 0, buckets);
+      for (i = lo; i < hi; i++)
+	{
+	  int x = src[i];
+	  unsigned int b = DIGIT (x, shift, mask);
+	  int *buf = wc + b * WC_KEYS;
+	  buf[fill[b]++] = x;
+	  if (fill[b] == WC_KEYS)
+	    {
+	      memcpy (dst + next[b], buf, WC_KEYS * sizeof (int));
+	      next[b] += WC_KEYS;
+	      fill[b] = 0;
+	    }
+	}
+      for (dg = 0; dg < buckets; dg++)
+	if (fill[dg] > 0)
+	  memcpy (dst + next[dg], wc + dg * WC_KEYS, fill[dg] * sizeof (int));
+      INSTR_STOP (t_scatter, INSTR_PUT, (hi - lo) * sizeof (int));
+    }
+  return 1;
+}
+
+// Parallel LSD radix sort of A[0 .. SIZE - 1] by BITS-bit digits,
+// through TEMP, with THREADS threads.
+void
+radix_lsd_omp (int a[], int size, int temp[], int threads, int bits)
+{
+  struct radix_scratch s;
+  int *src = a, *dst = temp, shift;
+  if (!radix_scratch_init (&s, threads, bits))
+    {
+      radix_scratch_free (&s);
+      run_omp (a, size, temp, threads);
+      return;
+    }
+  for (shift = 0; shift < 32; shift += bits)
+    if (radix_pass_omp (src, dst, size, shift, &s, NULL))
+      {
+	int *t = src;
+	src = dst;
+	dst = t;
+      }
+  if (src != a)
+    {
+      int i;
+#pragma omp parallel for num_threads (threads) schedule (static)
+      for (i = 0; i < threads; i++)
+	{
+	  int lo = (long) size * i / threads;
+	  int hi = (long) size * (i + 1) / threads;
+	  memcpy (a + lo, src + lo, (hi - lo) * sizeof (int));
+	}
+    }
+  radix_scratch_free (&s);
+}
+
+// Serial MSD radix sort of A[0 .. SIZE - 1], whose keys agree on the
+// digits above SHIFT + MSD_BITS, through TEMP
+static void
+radix_msd_serial (int a[], int size, int temp[], int shift)
+{
+  const unsigned int mask = (1 << MSD_BITS) - 1;
+  long count[1 << MSD_BITS], next[1 << MSD_BITS];
+  int i, d;
+  if (size <= MSD_SMALL)
+    {
+      mergesort_serial (a, size, temp);
+      return;
+    }
+  for (; shift >= 0; shift -= MSD_BITS)
+    {
+      memset (count, 0, sizeof (count));
+      for (i = 0; i < size; i++)
+	count[DIGIT (a[i], shift, mask)]++;
+      for (d = 0; d <= (int) mask && count[d] != size; d++)
+	;
+      // Unless all keys have this digit
+      if (d > (int) mask)
+	break;
+    }
+  if (shift < 0)
+    return;
+  long offset = 0;
+  for (d = 0; d <= (int) mask; d++)
+    {
+      next[d] = offset;
+      offset += count[d];
+    }
+  for (i = 0; i < size; i++)
+    temp[next[DIGIT (a[i], shift, mask)]++] = a[i];
+  memcpy (a, temp, size * sizeof (int));
+  if (shift == 0)
+    return;
+  for (d = 0, offset = 0; d <= (int) mask; offset += count[d++])
+    if (count[d] > 1)
+      radix_msd_serial (a + offset, count[d], temp + offset,
+			shift - MSD_BITS);
+}
+
+// Parallel MSD radix sort of A[0 .. SIZE - 1], through TEMP
+void
+radix_msd_omp (int a[], int size, int temp[], int threads)
+{
+  struct radix_scratch s;
+  long bucket[(1 << MSD_BITS) + 1];
+  int d, shift = 32 - MSD_BITS;
+  if (size <= MSD_SMALL || !radix_scratch_init (&s, threads, MSD_BITS))
+    {
+      if (size > MSD_SMALL)
+	radix_scratch_free (&s);
+      radix_msd_serial (a, size, temp, shift);
+      return;
+    }
+  if (!radix_pass_omp (a, temp, size, shift, &s, bucket))
+    {
+      // One bucket: sort on the next digit
+      radix_scratch_free (&s);
+      radix_msd_serial (a, size, temp, shift);
+      return;
+    }
+  radix_scratch_free (&s);
+  bucket[1 << MSD_BITS] = size;
+#pragma omp parallel num_threads (threads)
+  {
+#pragma omp for schedule (static)
+    for (d = 0; d < threads; d++)
+      {
+	int lo = (long) size * d / threads;
+	int hi = (long) size * (d + 1) / threads;
+	memcpy (a + lo, temp + lo, (hi - lo) * sizeof (int));
+      }
+    // Skewed keys make for uneven buckets; dynamic scheduling evens
+    // out all but the largest.
+#pragma omp for schedule (dynamic, 1)
+    for (d = 0; d < 1 << MSD_BITS; d++)
+      {
+	long lo = bucket[d], n = bucket[d + 1] - bucket[d];
+	if (n > 1)
+	  radix_msd_serial (a + lo, n, temp + lo, shift - MSD_BITS);
+      }
+  }
+}
@@ -0,0 +1,325 @@
+/* Selection: k-th element, top-k, partial sort and quantiles.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+// For jobs that need only the smallest K keys, or a few quantiles,
+// in O(n + k log k) rather than the O(n log n) of a full sort:
+//
+//   select_kth        quickselect, serial, in place
+//   topk_omp          the K smallest, sorted; each thread selects and
+//                     sorts the K smallest of its slice, and the
+//                     threads merge those pairwise, keeping K
+//   partial_sort_omp  topk_omp, in place: the K smallest, sorted, at
+//                     the front of the array, and the rest after them
+//   quantiles_omp     several order statistics at once: a select at
+//                     the middle one splits the array for the rest,
+//                     which are selected by tasks
+//
+// mpi_select.c is the distributed equivalent.
+
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "instrument.h"
+#include "msort.h"
+
+// Windows of this many elements, or fewer, are insertion sorted.
+#define SELECT_SMALL 16
+
+// Windows of quantiles_omp larger than this are selected by tasks.
+#define SELECT_TASK_MIN 65536
+
+// Rearrange A[0 .. SIZE - 1] into the elements less than, equal to
+// and greater than PIVOT, and return the first two counts.
+void
+select_partition (int a[], int size, int pivot, int *n_lt, int *n_eq)
+{
+  int lt = 0, i = 0, gt = size;
+  while (i < gt)
+    {
+      int v = a[i];
+      if (v < pivot)
+	{
+	  a[i++] = a[lt];
+	  a[lt++] = v;
+	}
+      else if (v > pivot)
+	{
+	  a[i] = a[--gt];
+	  a[gt] = v;
+	}
+      else
+	i++;
+    }
+  *n_lt = lt;
+  *n_eq = gt - lt;
+}
+
+static int
+median3 (int x, int y, int z)
+{
+  if (x > y)
+    {
+      int t = x;
+      x = y;
+      y = t;
+    }
+  return z < x ? x : z > y ? y : z;
+}
+
+// Return the K-th smallest (from 0) of A[0 .. SIZE - 1], and leave it
+// at A[K], with no greater element before it and no smaller one
+// after it.  Pivots are the median of three pseudo-random elements.
+int
+select_kth (int a[], int size, int k)
+{
+  unsigned int seed = 314159;
+  int lo = 0, hi = size, lt, eq;
+  while (hi - lo > SELECT_SMALL)
+    {
+      int n = hi - lo, x, y, z;
+      seed = seed * 1103515245 + 12345;
+      x = a[lo + (seed >> 8) % n];
+      seed = seed * 1103515245 + 12345;
+      y = a[lo + (seed >> 8) % n];
+      seed = seed * 1103515245 + 12345;
+      z = a[lo + (seed >> 8) % n];
+      int pivot = median3 (x, y, z);
+      select_partition (a + lo, n, pivot, &lt, &eq);
+      if (k < lo + lt)
+	hi = lo + lt;
+      else if (k < lo + lt + eq)
+	return pivot;
+      else
+	lo += lt + eq;
+    }
+  insertion_sort (a + lo, hi - lo);
+  return a[k];
+}
+
+// The first K of the stable merge of X[0 .. M - 1] and Y[0 .. N - 1],
+// into OUT; returns their number.
+static int
+merge_prefix (const int x[], int m, const int y[], int n, int k, int out[])
+{
+  int i = 0, j = 0, o = 0;
+  while (o < k && i < m && j < n)
+    out[o++] = y[j] < x[i] ? y[j++] : x[i++];
+  while (o < k && i < m)
+    out[o++] = x[i++];
+  while (o < k && j < n)
+    out[o++] = y[j++];
+  return o;
+}
+
+// Set OUT[0 .. K - 1] to the K smallest of A[0 .. SIZE - 1] (all of
+// them, if K > SIZE), in order.  A is not changed; TEMP holds SIZE
+// elements.  Returns 0 if out of memory.
+int
+topk_omp (const int a[], int size, int k, int out[], int temp[], int threads)
+{
+  if (k > size)
+    k = size;
+  if (k <= 0)
+    return 1;
+  int *bound = malloc (sizeof (int) * (threads + 1));
+  int *count = malloc (sizeof (int) * threads);
+  int *scratch = malloc (sizeof (int) * k * threads);
+  int t;
+  if (bound == NULL || count == NULL || scratch == NULL)
+    {
+      free (bound);
+      free (count);
+      free (scratch);
+      return 0;
+    }
+  for (t = 0; t <= threads; t++)
+    bound[t] = (long) size * t / threads;
+#pragma omp parallel num_threads (threads)
+  {
+    int me = omp_get_thread_num (), w, p;
+    int *mine = scratch + (long) k * me;
+#pragma omp for schedule (static, 1)
+    for (t = 0; t < threads; t++)
+      {
+	// The K smallest of the slice, sorted
+	int *s = temp + bound[t], len = bound[t + 1] - bound[t];
+	INSTR_START (t_leaf);
+	memcpy (s, a + bound[t], len * sizeof (int));
+	if (len > k)
+	  {
+	    select_kth (s, len, k - 1);
+	    len = k;
+	  }
+	mergesort_serial (s, len, mine);
+	count[t] = len;
+	INSTR_STOP (t_leaf, INSTR_LEAF_SORT, len * sizeof (int));
+      }
+    // Merge them pairwise; the K smallest of slices t .. t + 2w - 1
+    // end up at the front of slice t.
+    for (w = 1; w < threads; w *= 2)
+      {
+#pragma omp for schedule (dynamic, 1)
+	for (p = 0; p < threads; p += 2 * w)
+	  if (p + w < threads)
+	    {
+	      INSTR_START (t_merge);
+	      int n = merge_prefix (temp + bound[p], count[p],
+				    temp + bound[p + w], count[p + w], k,
+				    mine);
+	      memcpy (temp + bound[p], mine, n * sizeof (int));
+	      count[p] = n;
+	      INSTR_STOP_MERGE (t_merge, n);
+	    }
+      }
+  }
+  memcpy (out, temp, k * sizeof (int));
+  free (bound);
+  free (count);
+  free (scratch);
+  return 1;
+}
+
+// Rearrange A[0 .. SIZE - 1] so that its first K elements are the K
+// smallest, in order; the others follow in no particular order.
+// TEMP holds SIZE elements.  Returns 0 if out of memory.
+int
+partial_sort_omp (int a[], int size, int k, int temp[], int threads)
+{
+  if (k > size)
+    k = size;
+  if (k <= 0)
+    return 1;
+  int *front = malloc (sizeof (int) * k);
+  int *n_gt = malloc (sizeof (int) * (threads + 1));
+  int *n_eq = malloc (sizeof (int) * threads);
+  int t, extra;
+  if (front == NULL || n_gt == NULL || n_eq == NULL
+      || !topk_omp (a, size, k, front, temp, threads))
+    {
+      free (front);
+      free (n_gt);
+      free (n_eq);
+      return 0;
+    }
+  // FRONT holds every element less than its last, V, and some of the
+  // elements equal to V.  The rest are the other elements equal to
+  // V, then the greater ones.
+  int v = front[k - 1], v_front = 0;
+  while (v_front < k && front[k - 1 - v_front] == v)
+    v_front++;
+#pragma omp parallel for num_threads (threads) schedule (static, 1)
+  for (t = 0; t < threads; t++)
+    {
+      int i, hi = (long) size * (t + 1) / threads, gt = 0, eq = 0;
+      for (i = (long) size * t / threads; i < hi; i++)
+	{
+	  gt += a[i] > v;
+	  eq += a[i] == v;
+	}
+      n_gt[t + 1] = gt;
+      n_eq[t] = eq;
+    }
+  extra = -v_front;
+  n_gt[0] = 0;
+  for (t = 0; t < threads; t++)
+    {
+      extra += n_eq[t];
+      n_gt[t + 1] += n_gt[t];
+    }
+#pragma omp parallel for num_threads (threads) schedule (static, 1)
+  for (t = 0; t < threads; t++)
+    {
+      int i, hi = (long) size * (t + 1) / threads;
+      int *o = temp + k + extra + n_gt[t];
+      for (i = (long) size * t / threads; i < hi; i++)
+	if (a[i] > v)
+	  *o++ = a[i];
+    }
+  for (t = 0; t < extra; t++)
+    temp[k + t] = v;
+  memcpy (a, front, k * sizeof (int));
+  memcpy (a + k, temp + k, (size - k) * sizeof (int));
+  free (front);
+  free (n_gt);
+  free (n_eq);
+  return 1;
+}
+
+// Select the N order statistics RANK[0 .. N - 1] (ascending, within
+// [LO, HI)) of A, into OUT[WHICH[i]].
+static void
+multiselect (int a[], int lo, int hi, const int rank[], const int which[],
+	     int n, int out[])
+{
+  if (n == 0)
+    return;
+  int mid = n / 2, r = rank[mid], first = mid, last = mid + 1, i;
+  int v = select_kth (a + lo, hi - lo, r - lo);
+  while (first > 0 && rank[first - 1] == r)
+    first--;
+  while (last < n && rank[last] == r)
+    last++;
+  for (i = first; i < last; i++)
+    out[which[i]] = v;
+  // A[LO .. R - 1] and A[R + 1 .. HI - 1] hold the rest.
+#pragma omp task if (r - lo > SELECT_TASK_MIN)
+  multiselect (a, lo, r, rank, which, first, out);
+  multiselect (a, r + 1, hi, rank + last, which + last, n - last, out);
+#pragma omp taskwait
+}
+
+// Set OUT[i] to the Q[i] quantile of A[0 .. SIZE - 1], for N_Q
+// quantiles in [0, 1]: the element of rank Q[i] * (SIZE - 1), rounded
+// down.  A is rearranged.  Returns 0 if out of memory.
+int
+quantiles_omp (int a[], int size, const double q[], int n_q, int out[],
+	       int threads)
+{
+  int *rank = malloc (sizeof (int) * n_q);
+  int *which = malloc (sizeof (int) * n_q);
+  int i, j;
+  if (rank == NULL || which == NULL)
+    {
+      free (rank);
+      free (which);
+      return 0;
+    }
+  if (size == 0)
+    n_q = 0;
+  // Sort the ranks, remembering which quantile each is
+  for (i = 0; i < n_q; i++)
+    {
+      double qi = q[i] < 0.0 ? 0.0 : q[i] > 1.0 ? 1.0 : q[i];
+      int r = (int) (qi * (size - 1));
+      for (j = i - 1; j >= 0 && rank[j] > r; j--)
+	{
+	  rank[j + 1] = rank[j];
+	  which[j + 1] = which[j];
+	}
+      rank[j + 1] = r;
+      which[j + 1] = i;
+    }
+#pragma omp parallel num_threads (threads)
+#pragma omp single
+  multiselect (a, 0, size, rank, which, n_q, out);
+  free (rank);
+  free (which);
+  return 1;
+}
@@ -22,15 +22,17 @@
 #include <stdio.h>
 #include <string.h>
 #include <omp.h>
-
-// Arrays size <= SMALL switches to insertion sort
-#define SMALL    32
+#include "instrument.h"
+#include "sort_tune.h"
+#include "sort_affinity.h"
+#include "sort_validate.h"
 
 extern double get_time (void);
 void merge (int a[], int size, int temp[]);
 void insertion_sort (int a[], int size);
 void mergesort_serial (int a[], int size, int temp[]);
 void mergesort_parallel_omp (int a[], int size, int temp[], int threads);
+void mergesort_tasks_omp (int a[], int size, int temp[]);
 void run_omp (int a[], int size, int temp[], int threads);
 int main (int argc, char *argv[]);
 
@@ -38,6 +40,8 @@ int
 main (int argc, char *argv[])
 {
   puts ("-OpenMP Recursive Mergesort-\t");
+  // Tuning parameters of this host
+  tune_load ();
   // Check arguments
   if (argc != 3)		/* argc must be 3 for proper execution! */
     {
@@ -57,6 +61,8 @@ main (int argc, char *argv[])
   int processors = omp_get_num_procs ();	// Available processors
   printf ("Array size = %d\nProcesses = %d\nProcessors = %d\n",
 	  size, threads, processors);
+  if (sort_tune.task_cutoff > 0)
+    printf ("Task cutoff = %d\n", sort_tune.task_cutoff);
   if (threads > processors)
     {
       printf
@@ -71,6 +77,9 @@ main (int argc, char *argv[])
 	      threads, max_threads);
       return 1;
     }
+  // Placement of the threads, by $SORT_AFFINITY
+  affinity_init (0, threads, threads);
+  affinity_print ();
   // Array allocation
   int *a = malloc (sizeof (int) * size);
   int *temp = malloc (sizeof (int) * size);
@@ -86,23 +95,24 @@ main (int argc, char *argv[])
     {
       a[i] = rand () % size;
     }
+  // Checksum of the input, for the result check
+  struct sort_sum in = { 0, 0 };
+  int validate = sort_validate_enabled ();
+  if (validate)
+    in = sort_checksum (a, size);
   // Sort
   double start = get_time ();
   run_omp (a, size, temp, threads);
   double end = get_time ();
-  printf ("Start = %.2f\nEnd = %.2f\nElapsed = %.2f\n",
+  INSTR_RECORD (INSTR_TOTAL, start, end, size * sizeof (int));
+  affinity_release ();
+  printf ("Start = %.2f\nEnd = %.2f\nElapsed = %.6f\n",
 	  start, end, end - start);
   // Result check
-  for (i = 1; i < size; i++)
-    {
-      if (!(a[i - 1] <= a[i]))
-	{
-	  printf ("Implementation error: a[%d]=%d > a[%d]=%d\n", i - 1,
-		  a[i - 1], i, a[i]);
-	  return 1;
-	}
-    }
+  if (validate && !sort_validate (a, size, &in))
+    return 1;
   puts ("-Success-");
+  INSTR_REPORT ("omp_mergesort", size);
   return 0;
 }
 
@@ -113,7 +123,47 @@ run_omp (int a[], int size, int temp[], int threads)
   // Enable nested parallelism, if available
   omp_set_nested (1);
   // Parallel mergesort
-  mergesort_parallel_omp (a, size, temp, threads);
+  if (sort_tune.task_cutoff > 0)
+    {
+      // One team of THREADS threads, which runs the recursive sorts
+      // as tasks
+#pragma omp parallel num_threads (threads)
+      {
+	affinity_enter (omp_get_thread_num ());
+#pragma omp single
+	mergesort_tasks_omp (a, size, temp);
+      }
+    }
+  else
+    mergesort_parallel_omp (a, size, temp, threads);
+}
+
+// OpenMP merge sort with a task per recursive sort, down to
+// sort_tune.task_cutoff elements
+void
+mergesort_tasks_omp (int a[], int size, int temp[])
+{
+  if (size <= sort_tune.task_cutoff)
+    {
+      INSTR_START (t_leaf);
+      mergesort_serial (a, size, temp);
+      INSTR_STOP (t_leaf, INSTR_LEAF_SORT, size * sizeof (int));
+    }
+  else
+    {
+      INSTR_START (t_sort);
+#pragma omp task
+      mergesort_tasks_omp (a, size / 2, temp);
+      mergesort_tasks_omp (a + size / 2, size - size / 2, temp + size / 2);
+      INSTR_START (t_wait);
+#pragma omp taskwait
+      INSTR_STOP (t_wait, INSTR_BARRIER, 0);
+      // Merge the two sorted sub-arrays through temp
+      INSTR_START (t_merge);
+      merge (a, size, temp);
+      INSTR_STOP_MERGE (t_merge, size);
+      INSTR_STOP (t_sort, INSTR_SORT, size * sizeof (int));
+    }
 }
 
 // OpenMP merge sort with given number of threads
@@ -123,27 +173,42 @@ mergesort_parallel_omp (int a[], int size, int temp[], int threads)
   if (threads == 1)
     {
 //        printf("Thread %d begins serial merge sort\n", omp_get_thread_num());
+      INSTR_START (t_leaf);
       mergesort_serial (a, size, temp);
+      INSTR_STOP (t_leaf, INSTR_LEAF_SORT, size * sizeof (int));
     }
   else if (threads > 1)
     {
+      // Workers first to first + threads - 1 of the process
+      int first = affinity_worker ();
+      INSTR_START (t_sort);
+      INSTR_DECLARE (t_left_done);
+      INSTR_DECLARE (t_right_done);
 #pragma omp parallel sections
       {
 //                      printf("Thread %d begins recursive section\n", omp_get_thread_num());
 #pragma omp section
 	{			//printf("Thread %d begins recursive call\n", omp_get_thread_num());
+	  affinity_enter (first);
 	  mergesort_parallel_omp (a, size / 2, temp, threads / 2);
+	  INSTR_STAMP (t_left_done);
 	}
 #pragma omp section
 	{			//printf("Thread %d begins recursive call\n", omp_get_thread_num());
+	  affinity_enter (first + threads / 2);
 	  mergesort_parallel_omp (a + size / 2, size - size / 2,
 				  temp + size / 2, threads - threads / 2);
+	  INSTR_STAMP (t_right_done);
 	}
       }
+      INSTR_JOIN_WAIT (t_left_done, t_right_done);
       // Thread allocation is implementation dependent
       // Some threads can execute multiple sections while others are idle 
       // Merge the two sorted sub-arrays through temp
+      INSTR_START (t_merge);
       merge (a, size, temp);
+      INSTR_STOP_MERGE (t_merge, size);
+      INSTR_STOP (t_sort, INSTR_SORT, size * sizeof (int));
     }
   else
     {
@@ -156,7 +221,7 @@ void
 mergesort_serial (int a[], int size, int temp[])
 {
   // Switch to insertion sort for small arrays
-  if (size <= SMALL)
+  if (size <= sort_tune.small)
     {
       insertion_sort (a, size);
       return;
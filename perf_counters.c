@@ -0,0 +1,124 @@
+/* Hardware performance counters for the merge sort drivers.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "perf_counters.h"
+
+#define CACHE_MISS(cache) \
+  ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) \
+   | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+static const struct
+{
+  uint32_t type;
+  uint64_t config;
+} perf_event_spec[PERF_N_EVENTS] = {
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+  {PERF_TYPE_HW_CACHE, CACHE_MISS (PERF_COUNT_HW_CACHE_LL)},
+  {PERF_TYPE_HW_CACHE, CACHE_MISS (PERF_COUNT_HW_CACHE_DTLB)},
+};
+
+const char *const perf_event_name[PERF_N_EVENTS] = {
+  "cycles", "instructions", "branch_misses", "llc_misses", "dtlb_misses"
+};
+
+// Per thread: the group leader's descriptor (-1 if no event could be
+// opened), and the position of each event in the group read, or -1.
+static __thread int perf_opened;
+static __thread int perf_leader = -1;
+static __thread int perf_n_members;
+static __thread int perf_index[PERF_N_EVENTS];
+// Events that some thread failed to open.
+static int perf_missing_mask;
+static int perf_warned;
+
+static int
+perf_open_event (int event, int group_fd)
+{
+  struct perf_event_attr attr;
+  memset (&attr, 0, sizeof (attr));
+  attr.size = sizeof (attr);
+  attr.type = perf_event_spec[event].type;
+  attr.config = perf_event_spec[event].config;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP
+    | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return syscall (SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+static void
+perf_open_group (void)
+{
+  perf_opened = 1;
+  for (int event = 0; event < PERF_N_EVENTS; event++)
+    {
+      int fd = perf_open_event (event, perf_leader);
+      if (fd < 0)
+	{
+	  if (!__atomic_exchange_n (&perf_warned, 1, __ATOMIC_RELAXED))
+	    fprintf (stderr, "Warning: perf_event_open (%s): %s\n",
+		     perf_event_name[event], strerror (errno));
+	  __atomic_fetch_or (&perf_missing_mask, 1 << event,
+			     __ATOMIC_RELAXED);
+	  perf_index[event] = -1;
+	  continue;
+	}
+      if (perf_leader < 0)
+	perf_leader = fd;
+      perf_index[event] = perf_n_members++;
+    }
+}
+
+// Read the calling thread's counters, scaled for multiplexing.
+void
+perf_read (double counter[PERF_N_EVENTS])
+{
+  uint64_t buf[3 + PERF_N_EVENTS];
+  if (!perf_opened)
+    perf_open_group ();
+  memset (counter, 0, PERF_N_EVENTS * sizeof (double));
+  if (perf_leader < 0)
+    return;
+  ssize_t n = read (perf_leader, buf, sizeof (buf));
+  if (n < (ssize_t) ((3 + perf_n_members) * sizeof (uint64_t)))
+    return;
+  // buf[0] = nr, buf[1] = time enabled, buf[2] = time running.
+  double scale = buf[2] ? (double) buf[1] / (double) buf[2] : 0.0;
+  for (int event = 0; event < PERF_N_EVENTS; event++)
+    if (perf_index[event] >= 0)
+      counter[event] = (double) buf[3 + perf_index[event]] * scale;
+}
+
+int
+perf_available (int event)
+{
+  return !(__atomic_load_n (&perf_missing_mask, __ATOMIC_RELAXED)
+	   & (1 << event));
+}
@@ -0,0 +1,57 @@
+/* Hardware performance counters for the merge sort drivers.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+// Built with SORT_PERF (make PERF=1, which implies STATS=1), each
+// thread opens a perf_event_open group the first time it enters an
+// instrumented phase, and the counters below are accumulated per
+// phase alongside the instrument.h timers.  The Stats summary then
+// carries the raw counts and, per phase, instructions per cycle,
+// misses per element and GB/s.
+//
+// Only user-space events of the calling thread are counted, which
+// perf_event_paranoid <= 2 permits.  Events that the kernel or the
+// CPU does not support read as zero and are reported as null.
+
+#ifdef SORT_PERF
+
+enum perf_event_id
+{
+  PERF_CYCLES,
+  PERF_INSTRUCTIONS,
+  PERF_BRANCH_MISSES,
+  PERF_LLC_MISSES,
+  PERF_DTLB_MISSES,
+  PERF_N_EVENTS
+};
+
+extern const char *const perf_event_name[PERF_N_EVENTS];
+extern void perf_read (double counter[PERF_N_EVENTS]);
+extern int perf_available (int event);
+
+#else
+
+#define PERF_N_EVENTS 0
+
+#endif /* SORT_PERF */
+
+#endif /* PERF_COUNTERS_H */
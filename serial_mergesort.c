@@ -27,9 +27,9 @@
 #else
 #include <sys/time.h>
 #endif
-
-// Arrays size <= SMALL switches to insertion sort
-#define SMALL    32
+#include "instrument.h"
+#include "sort_tune.h"
+#include "sort_validate.h"
 
 void merge (int a[], int size, int temp[]);
 void insertion_sort (int a[], int size);
@@ -41,6 +41,8 @@ int
 main (int argc, char *argv[])
 {
   puts ("-Serial Recursive Mergesort-\t");
+  // Tuning parameters of this host
+  tune_load ();
   // Check arguments
   if (argc != 2)		/* argc must be 2 for proper execution! */
     {
@@ -65,23 +67,24 @@ main (int argc, char *argv[])
     {
       a[i] = rand () % size;
     }
+  // Checksum of the input, for the result check
+  struct sort_sum in = { 0, 0 };
+  int validate = sort_validate_enabled ();
+  if (validate)
+    in = sort_checksum (a, size);
   // Sort
   double start = get_time ();
   mergesort_serial (a, size, temp);
   double end = get_time ();
-  printf ("Start = %.2f\nEnd = %.2f\nElapsed = %.2f\n",
+  INSTR_RECORD (INSTR_LEAF_SORT, start, end, size * sizeof (int));
+  INSTR_RECORD (INSTR_TOTAL, start, end, size * sizeof (int));
+  printf ("Start = %.2f\nEnd = %.2f\nElapsed = %.6f\n",
 	  start, end, end - start);
   // Result check
-  for (i = 1; i < size; i++)
-    {
-      if (!(a[i - 1] <= a[i]))
-	{
-	  printf ("Implementation error: a[%d]=%d > a[%d]=%d\n", i - 1,
-		  a[i - 1], i, a[i]);
-	  return 1;
-	}
-    }
+  if (validate && !sort_validate (a, size, &in))
+    return 1;
   puts ("-Success-");
+  INSTR_REPORT ("serial_mergesort", size);
   return 0;
 }
 
@@ -89,7 +92,7 @@ void
 mergesort_serial (int a[], int size, int temp[])
 {
   // Switch to insertion sort for small arrays
-  if (size <= SMALL)
+  if (size <= sort_tune.small)
     {
       insertion_sort (a, size);
       return;
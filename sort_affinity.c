@@ -0,0 +1,287 @@
+/* Placement of the workers of the merge sort drivers on CPUs.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sched.h>
+#include "sort_affinity.h"
+
+#define CPU_SYSFS "/sys/devices/system/cpu"
+
+struct cpu_topo
+{
+  int cpu, package, l3, core;
+};
+
+static const char *policy_name[] = {
+  "none", "compact", "scatter", "core", "nosmt"
+};
+
+static enum affinity_policy policy = AFFINITY_NONE;
+
+// The CPUs this process may run on, in placement order
+static struct cpu_topo topo[CPU_SETSIZE];
+static int n_cpus;
+
+// The index in topo of the first CPU of each core, and of the first
+// core of each package; each has a final entry past the last.
+static int core_start[CPU_SETSIZE + 1], n_cores;
+static int package_start[CPU_SETSIZE + 1], n_packages;
+
+// The workers of this process, of the N_WORKERS of its node
+static int first_worker, n_local, n_workers;
+
+// The worker this thread has taken up, and the CPU it is bound to
+static __thread int thread_worker;
+static __thread int thread_cpu = -1;
+
+static int
+read_id (int cpu, const char *file, int fallback)
+{
+  char path[128];
+  int id;
+  snprintf (path, sizeof (path), CPU_SYSFS "/cpu%d/%s", cpu, file);
+  FILE *f = fopen (path, "r");
+  if (f == NULL)
+    return fallback;
+  if (fscanf (f, "%d", &id) != 1)
+    id = fallback;
+  fclose (f);
+  return id;
+}
+
+static int
+topo_compare (const void *x, const void *y)
+{
+  const struct cpu_topo *a = x, *b = y;
+  if (a->package != b->package)
+    return a->package < b->package ? -1 : 1;
+  if (a->l3 != b->l3)
+    return a->l3 < b->l3 ? -1 : 1;
+  if (a->core != b->core)
+    return a->core < b->core ? -1 : 1;
+  return a->cpu < b->cpu ? -1 : a->cpu > b->cpu;
+}
+
+// The CPUs this process may run on, as a mask of AFFINITY_MASK_WORDS
+// words.  Returns 0 on failure.
+int
+affinity_allowed (unsigned long mask[])
+{
+  cpu_set_t allowed;
+  if (sched_getaffinity (0, sizeof (allowed), &allowed) != 0)
+    {
+      perror ("sched_getaffinity");
+      return 0;
+    }
+  memcpy (mask, &allowed, AFFINITY_MASK_WORDS * sizeof (unsigned long));
+  return 1;
+}
+
+// Read the topology of the CPUs in MASK.  Returns 0 if it is empty.
+static int
+read_topology (const unsigned long mask[])
+{
+  cpu_set_t allowed;
+  int cpu, i;
+  memcpy (&allowed, mask, AFFINITY_MASK_WORDS * sizeof (unsigned long));
+  n_cpus = 0;
+  for (cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    if (CPU_ISSET (cpu, &allowed))
+      {
+	struct cpu_topo *t = &topo[n_cpus++];
+	t->cpu = cpu;
+	t->package = read_id (cpu, "topology/physical_package_id", 0);
+	t->core = read_id (cpu, "topology/core_id", cpu);
+	// Without an L3, or its id, take the package as the L3
+	t->l3 = read_id (cpu, "cache/index3/id", t->package);
+      }
+  qsort (topo, n_cpus, sizeof (topo[0]), topo_compare);
+  n_cores = n_packages = 0;
+  for (i = 0; i < n_cpus; i++)
+    {
+      if (i == 0 || topo[i].package != topo[i - 1].package)
+	package_start[n_packages++] = n_cores;
+      if (i == 0 || topo[i].package != topo[i - 1].package
+	  || topo[i].core != topo[i - 1].core)
+	core_start[n_cores++] = i;
+    }
+  core_start[n_cores] = n_cpus;
+  package_start[n_packages] = n_cores;
+  return n_cpus > 0;
+}
+
+// The CPU of worker W of N that share cores C0 to C0 + K - 1: a core
+// each, or W * K / N when they outnumber the cores, on the SMT
+// siblings in turn unless NOSMT.
+static int
+core_cpu (int w, int n, int c0, int k, int nosmt)
+{
+  int core, smt = 0;
+  if (n <= k)
+    core = w;
+  else
+    {
+      core = (long long) w *k / n;
+      // W's place among the workers of its core
+      smt = w - (int) (((long long) core * n + k - 1) / k);
+    }
+  int first = core_start[c0 + core], siblings =
+    core_start[c0 + core + 1] - first;
+  return topo[first + (nosmt ? 0 : smt % siblings)].cpu;
+}
+
+// The CPU of worker W of the N of this node, or -1 to leave it alone.
+int
+affinity_cpu (int w, int n)
+{
+  int p, wp, np;
+  switch (policy)
+    {
+    case AFFINITY_COMPACT:
+      return topo[w % n_cpus].cpu;
+    case AFFINITY_CORE:
+    case AFFINITY_NOSMT:
+      return core_cpu (w, n, 0, n_cores, policy == AFFINITY_NOSMT);
+    case AFFINITY_SCATTER:
+      // An even share of the workers on each package
+      p = (long long) w *n_packages / n;
+      wp = ((long long) p * n + n_packages - 1) / n_packages;
+      np = ((long long) (p + 1) * n + n_packages - 1) / n_packages - wp;
+      return core_cpu (w - wp, np, package_start[p],
+		       package_start[p + 1] - package_start[p], 0);
+    default:
+      return -1;
+    }
+}
+
+static void
+bind_cpus (cpu_set_t *set)
+{
+  if (sched_setaffinity (0, sizeof (*set), set) != 0)
+    perror ("sched_setaffinity");
+}
+
+// Set the policy from $SORT_AFFINITY, read the topology of the CPUs
+// in MASK (if NULL, those this process may run on), and bind this
+// thread to worker FIRST of the N of this node; this process runs
+// workers FIRST to FIRST + COUNT - 1.  Returns 0 if the workers are
+// not placed.
+int
+affinity_init_mask (int first, int count, int n, const unsigned long mask[])
+{
+  const char *name = getenv ("SORT_AFFINITY");
+  unsigned long allowed[AFFINITY_MASK_WORDS];
+  int i;
+  policy = AFFINITY_NONE;
+  if (name == NULL || *name == '\0')
+    return 0;
+  for (i = 0; i < (int) (sizeof (policy_name) / sizeof (policy_name[0])); i++)
+    if (strcmp (name, policy_name[i]) == 0)
+      policy = i;
+  if (policy == AFFINITY_NONE)
+    {
+      if (strcmp (name, "none") != 0)
+	printf ("Warning: unknown SORT_AFFINITY '%s', not placing threads\n",
+		name);
+      return 0;
+    }
+  if (mask == NULL)
+    {
+      if (!affinity_allowed (allowed))
+	{
+	  policy = AFFINITY_NONE;
+	  return 0;
+	}
+      mask = allowed;
+    }
+  if (!read_topology (mask))
+    {
+      policy = AFFINITY_NONE;
+      return 0;
+    }
+  first_worker = first;
+  n_local = count;
+  n_workers = n;
+  affinity_enter (0);
+  return 1;
+}
+
+int
+affinity_init (int first, int count, int n)
+{
+  return affinity_init_mask (first, count, n, NULL);
+}
+
+// Bind this thread to worker W of this process.
+void
+affinity_enter (int w)
+{
+  thread_worker = w;
+  if (policy == AFFINITY_NONE)
+    return;
+  int cpu = affinity_cpu (first_worker + w, n_workers);
+  if (cpu < 0 || cpu == thread_cpu)
+    return;
+  cpu_set_t set;
+  CPU_ZERO (&set);
+  CPU_SET (cpu, &set);
+  bind_cpus (&set);
+  thread_cpu = cpu;
+}
+
+// The worker of this process that this thread has taken up.
+int
+affinity_worker (void)
+{
+  return thread_worker;
+}
+
+// Bind this thread to the CPUs of all the workers of this process.
+void
+affinity_release (void)
+{
+  if (policy == AFFINITY_NONE)
+    return;
+  cpu_set_t set;
+  int w;
+  CPU_ZERO (&set);
+  for (w = 0; w < n_local; w++)
+    CPU_SET (affinity_cpu (first_worker + w, n_workers), &set);
+  bind_cpus (&set);
+  thread_cpu = -1;
+}
+
+// Print the policy, the topology and the CPU of each worker of the
+// node.
+void
+affinity_print (void)
+{
+  int w;
+  if (policy == AFFINITY_NONE)
+    return;
+  printf ("Affinity = %s (%d packages, %d cores, %d CPUs): CPUs",
+	  policy_name[policy], n_packages, n_cores, n_cpus);
+  for (w = 0; w < n_workers; w++)
+    printf ("%c%d", w ? ',' : ' ', affinity_cpu (w, n_workers));
+  putchar ('\n');
+}
@@ -0,0 +1,121 @@
+/* Placement of the workers of the merge sort drivers on CPUs.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef SORT_AFFINITY_H
+#define SORT_AFFINITY_H
+
+// The workers of a node (its ranks, UPC threads or OpenMP threads)
+// are numbered so that the subtrees of the sort that merge together
+// are numbered contiguously.  Each is bound to a CPU by the policy in
+// $SORT_AFFINITY, with the CPUs that the process may run on ordered
+// by socket, L3 cache, core and SMT sibling, as read from
+// /sys/devices/system/cpu:
+//
+//   compact  fill SMT siblings, then cores, then sockets;
+//   scatter  split the workers evenly over the sockets, then as core;
+//   core     a worker per core, SMT siblings only when the workers
+//            outnumber the cores;
+//   nosmt    a worker per core, never on SMT siblings;
+//   none     leave placement to the OS (the default).
+//
+// Each policy gives contiguous workers nearby CPUs, so sibling
+// subtrees tend to share a core or an L3 cache.
+//
+// A process calls affinity_init for its workers, which binds its
+// thread to its first worker, and affinity_enter as each thread
+// takes up worker I of the process (e.g. in each section of the
+// OpenMP recursion).  affinity_release binds the calling thread to
+// all the process's CPUs again, for the threads created after the
+// sort.
+
+#include <stddef.h>
+
+enum affinity_policy
+{
+  AFFINITY_NONE,
+  AFFINITY_COMPACT,
+  AFFINITY_SCATTER,
+  AFFINITY_CORE,
+  AFFINITY_NOSMT
+};
+
+// The size of a CPU mask, as of a cpu_set_t
+#define AFFINITY_MASK_WORDS (1024 / (8 * sizeof (unsigned long)))
+
+extern int affinity_allowed (unsigned long mask[]);
+extern int affinity_init_mask (int first, int count, int n_workers,
+			       const unsigned long mask[]);
+extern int affinity_init (int first, int count, int n_workers);
+extern void affinity_enter (int worker);
+extern int affinity_worker (void);
+extern void affinity_release (void);
+extern int affinity_cpu (int worker, int n_workers);
+extern void affinity_print (void);
+
+#ifdef MPI_VERSION
+#include <stdlib.h>
+#include <string.h>
+
+// The position of RANK in the mpi_mergesort tree, in which rank R
+// first merges with R + 2^L, for the largest 2^L: its bits reversed.
+// Ranks whose subtrees merge together are adjacent in this order.
+static inline int
+affinity_tree_key (int rank)
+{
+  unsigned int r = rank, key = 0;
+  int i;
+  for (i = 0; i < 31; i++, r >>= 1)
+    key = (key << 1) | (r & 1);
+  return key;
+}
+
+// Collective over COMM: affinity_init for THREADS workers per rank,
+// with the ranks of each node in the order of their KEYs, over all
+// the CPUs that the ranks of the node may run on (a launcher may have
+// bound each to a core or a socket).
+static inline int
+affinity_init_mpi (MPI_Comm comm, int key, int threads)
+{
+  MPI_Comm node;
+  unsigned long mask[AFFINITY_MASK_WORDS];
+  int node_size, i, before = 0;
+  MPI_Comm_split_type (comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node);
+  MPI_Comm_size (node, &node_size);
+  int *keys = malloc (node_size * sizeof (int));
+  if (keys == NULL)
+    {
+      printf ("Error: Could not allocate array of size %d\n", node_size);
+      MPI_Abort (MPI_COMM_WORLD, 1);
+    }
+  MPI_Allgather (&key, 1, MPI_INT, keys, 1, MPI_INT, node);
+  for (i = 0; i < node_size; i++)
+    before += keys[i] < key;
+  free (keys);
+  if (!affinity_allowed (mask))
+    memset (mask, 0, sizeof (mask));
+  MPI_Allreduce (MPI_IN_PLACE, mask, AFFINITY_MASK_WORDS, MPI_UNSIGNED_LONG,
+		 MPI_BOR, node);
+  MPI_Comm_free (&node);
+  return affinity_init_mask (before * threads, threads, node_size * threads,
+			     mask);
+}
+#endif
+
+#endif /* SORT_AFFINITY_H */
@@ -0,0 +1,138 @@
+/* Local merge sort service: client library.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "sort_service.h"
+
+const char *
+sort_service_path (char *buf, size_t len)
+{
+  const char *path = getenv ("SORT_SOCKET");
+  if (path != NULL && *path)
+    return path;
+  snprintf (buf, len, "/tmp/sortd.%u", (unsigned) getuid ());
+  return buf;
+}
+
+// Returns a socket connected to sortd at PATH, or -1.
+int
+sort_service_connect (const char *path)
+{
+  struct sockaddr_un addr;
+  int sock = socket (AF_UNIX, SOCK_SEQPACKET, 0);
+  if (sock < 0)
+    {
+      perror ("socket");
+      return -1;
+    }
+  memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  snprintf (addr.sun_path, sizeof (addr.sun_path), "%s", path);
+  if (connect (sock, (struct sockaddr *) &addr, sizeof (addr)) != 0)
+    {
+      perror (path);
+      close (sock);
+      return -1;
+    }
+  return sock;
+}
+
+// Allocate an array of COUNT ints in a new shared memory file, whose
+// descriptor is returned in *FD.  Returns NULL on failure.
+int *
+sort_service_alloc (size_t count, int *fd)
+{
+  size_t bytes = count * sizeof (int);
+  *fd = memfd_create ("sort_array", MFD_CLOEXEC);
+  if (*fd < 0)
+    {
+      perror ("memfd_create");
+      return NULL;
+    }
+  if (ftruncate (*fd, bytes) != 0)
+    {
+      perror ("ftruncate");
+      close (*fd);
+      return NULL;
+    }
+  void *a = mmap (NULL, bytes ? bytes : 1, PROT_READ | PROT_WRITE,
+		  MAP_SHARED, *fd, 0);
+  if (a == MAP_FAILED)
+    {
+      perror ("mmap");
+      close (*fd);
+      return NULL;
+    }
+  return a;
+}
+
+void
+sort_service_free (int *a, size_t count, int fd)
+{
+  munmap (a, count ? count * sizeof (int) : 1);
+  close (fd);
+}
+
+// Send a request, with FD if it is not negative, and wait for the
+// reply.  Returns 0, or an errno value from the call or from sortd.
+int
+sort_service_call (int sock, uint32_t op, int fd, size_t offset,
+		   size_t count, double *elapsed)
+{
+  struct sort_request req = { SORT_SERVICE_MAGIC, op, offset, count };
+  struct sort_reply reply;
+  union
+  {
+    char buf[CMSG_SPACE (sizeof (int))];
+    struct cmsghdr align;
+  } control;
+  struct iovec iov = { &req, sizeof (req) };
+  struct msghdr msg;
+  memset (&msg, 0, sizeof (msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  if (fd >= 0)
+    {
+      memset (&control, 0, sizeof (control));
+      msg.msg_control = control.buf;
+      msg.msg_controllen = sizeof (control.buf);
+      struct cmsghdr *cmsg = CMSG_FIRSTHDR (&msg);
+      cmsg->cmsg_level = SOL_SOCKET;
+      cmsg->cmsg_type = SCM_RIGHTS;
+      cmsg->cmsg_len = CMSG_LEN (sizeof (int));
+      memcpy (CMSG_DATA (cmsg), &fd, sizeof (int));
+    }
+  if (sendmsg (sock, &msg, 0) != (ssize_t) sizeof (req))
+    return errno ? errno : EIO;
+  ssize_t n = recv (sock, &reply, sizeof (reply), 0);
+  if (n != (ssize_t) sizeof (reply) || reply.magic != SORT_SERVICE_MAGIC)
+    return n < 0 ? errno : EPROTO;
+  if (elapsed != NULL)
+    *elapsed = reply.elapsed;
+  return reply.status;
+}
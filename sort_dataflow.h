@@ -0,0 +1,117 @@
+/* Completion flags between the passes of the block merge sorts.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef SORT_DATAFLOW_H
+#define SORT_DATAFLOW_H
+
+// In pass L of the block merge sorts, the leader of each group of
+// 2^L ranks (or UPC threads) R merges its own chunk with that of
+// rank R + 2^(L - 1), which that rank produced in pass L - 1, and
+// which nobody else reads.  So rather than wait at a barrier for all
+// ranks to finish each pass, a leader need only wait for its one
+// producer: when rank P first is not a leader, in pass L, it has no
+// more work, and it signals the flag of pass L of rank P - 2^(L - 1),
+// which waits on it.
+//
+// The flags are in MPI a window of PASS_LEVELS ints per rank, set by
+// MPI_Accumulate after the producer's chunk is flushed to rank 0, and
+// polled by MPI_Fetch_and_op; in UPC, strict shared ints, whose write
+// follows the producer's upc_memput.
+
+#include <string.h>
+
+// Passes: one per bit of a rank
+#define PASS_LEVELS 32
+
+#ifdef MPI_VERSION
+struct pass_flags
+{
+  MPI_Win win;
+  int rank;
+};
+
+// Collective over COMM: allocate cleared flags.
+static inline void
+pass_flags_init_mpi (struct pass_flags *f, MPI_Comm comm)
+{
+  int *flags;
+  MPI_Comm_rank (comm, &f->rank);
+  MPI_Win_allocate (PASS_LEVELS * sizeof (int), sizeof (int), MPI_INFO_NULL,
+		    comm, &flags, &f->win);
+  MPI_Win_lock_all (MPI_MODE_NOCHECK, f->win);
+  memset (flags, 0, PASS_LEVELS * sizeof (int));
+  MPI_Win_sync (f->win);
+  MPI_Barrier (comm);
+}
+
+// Tell DEST that this rank's output for its pass LEVEL is complete,
+// as by MPI_Win_flush.
+static inline void
+pass_signal_mpi (struct pass_flags *f, int dest, int level)
+{
+  const int one = 1;
+  MPI_Accumulate (&one, 1, MPI_INT, dest, level, 1, MPI_INT, MPI_REPLACE,
+		  f->win);
+  MPI_Win_flush (dest, f->win);
+}
+
+// Wait until this rank's producer for pass LEVEL signals.
+static inline void
+pass_wait_mpi (struct pass_flags *f, int level)
+{
+  int done = 0;
+  while (!done)
+    {
+      MPI_Fetch_and_op (NULL, &done, MPI_INT, f->rank, level, MPI_NO_OP,
+			f->win);
+      MPI_Win_flush (f->rank, f->win);
+    }
+}
+
+// Collective: free the flags.
+static inline void
+pass_flags_free_mpi (struct pass_flags *f)
+{
+  MPI_Win_unlock_all (f->win);
+  MPI_Win_free (&f->win);
+}
+#endif
+
+#ifdef __UPC__
+static strict shared [PASS_LEVELS] int pass_ready[PASS_LEVELS * THREADS];
+
+// Tell thread DEST that this thread's output for its pass LEVEL is
+// complete.  The strict write follows all earlier shared accesses.
+static inline void
+pass_signal_upc (int dest, int level)
+{
+  pass_ready[dest * PASS_LEVELS + level] = 1;
+}
+
+// Wait until this thread's producer for pass LEVEL signals.
+static inline void
+pass_wait_upc (int level)
+{
+  while (!pass_ready[MYTHREAD * PASS_LEVELS + level])
+    ;
+}
+#endif
+
+#endif /* SORT_DATAFLOW_H */
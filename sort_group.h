@@ -0,0 +1,184 @@
+/* Merges fused with the grouping of equal keys.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef SORT_GROUP_H
+#define SORT_GROUP_H
+
+// A merge sort ends by merging two sorted halves into TEMP and
+// copying TEMP back.  merge_groups does the last merge that way, and
+// in the copy back, rather than in a pass of its own, finds the
+// groups of equal keys: it writes the first key of each group (as
+// for a unique), the size of each (a run-length count), or the
+// offset of each in the sorted array.
+//
+// Each of THREADS threads merges the part of the output that it
+// splits off by co-ranking, and counts the groups that start in it.
+// The counts place each thread's groups in the output; the threads
+// then copy back their parts, writing their groups there.  A group
+// that spans parts is started by the first, and the sizes of its
+// pieces in the others are added to it at the end.
+
+#include <string.h>
+
+// Merges below this size are done by one thread.
+#define GROUP_SPLIT_MIN 65536
+
+// The number of elements of X among the first K of the merge of X[0
+// .. M - 1] and Y[0 .. N - 1], which takes X first on ties
+static inline int
+group_co_rank (int k, const int x[], int m, const int y[], int n)
+{
+  int lo = k > n ? k - n : 0, hi = k < m ? k : m;
+  while (lo < hi)
+    {
+      int i = lo + (hi - lo) / 2;
+      if (x[i] <= y[k - i - 1])
+	lo = i + 1;
+      else
+	hi = i;
+    }
+  return lo;
+}
+
+// Merge output elements K0 .. K1 - 1 of the halves of A into
+// TEMP[K0 .. K1 - 1], and return the number of groups that start
+// there.
+static inline int
+group_merge_part (const int a[], int size, int left_size, int temp[],
+		  int k0, int k1)
+{
+  const int *x = a, *y = a + left_size;
+  int m = left_size, n = size - left_size;
+  int i0 = group_co_rank (k0, x, m, y, n);
+  int i1 = group_co_rank (k1, x, m, y, n);
+  int j0 = k0 - i0, j1 = k1 - i1, groups = 0, last;
+  const int *xp = x + i0, *x_end = x + i1, *yp = y + j0, *y_end = y + j1;
+  int *out = temp + k0;
+  if (k0 == k1)
+    return 0;
+  if (k0 == 0)
+    {
+      // The first key starts a group; the rest are compared with it.
+      last = xp < x_end && (yp == y_end || *xp <= *yp) ? *xp : *yp;
+      groups = 1;
+    }
+  // The key before the part is the greater of the last ones taken.
+  else if (i0 == 0 || (j0 > 0 && y[j0 - 1] > x[i0 - 1]))
+    last = y[j0 - 1];
+  else
+    last = x[i0 - 1];
+  while (xp < x_end && yp < y_end)
+    {
+      int v = *yp < *xp ? *yp++ : *xp++;
+      groups += v != last;
+      *out++ = last = v;
+    }
+  while (xp < x_end)
+    {
+      groups += *xp != last;
+      *out++ = last = *xp++;
+    }
+  while (yp < y_end)
+    {
+      groups += *yp != last;
+      *out++ = last = *yp++;
+    }
+  return groups;
+}
+
+// Copy TEMP[K0 .. K1 - 1] back to A, as directed by merge_groups, its
+// groups numbered from FIRST.  Returns the number of keys before the
+// first group that starts in the part.
+static inline int
+group_copy_part (int a[], const int temp[], int counts[],
+		 int offsets[], int k0, int k1, int first)
+{
+  int k = k0, start = -1;
+  // Keys of a group started by an earlier part
+  while (k < k1 && k > 0 && temp[k] == temp[k - 1])
+    k++;
+  int lead = k - k0;
+  if (offsets != NULL)
+    memcpy (a + k0, temp + k0, (k1 - k0) * sizeof (int));
+  for (; k < k1; k++)
+    if (k == 0 || temp[k] != temp[k - 1])
+      {
+	if (offsets != NULL)
+	  offsets[first] = k;
+	else
+	  a[first] = temp[k];
+	if (counts != NULL && start >= 0)
+	  counts[first - 1] = k - start;
+	start = k;
+	first++;
+      }
+  if (counts != NULL && start >= 0)
+    counts[first - 1] = k1 - start;
+  return lead;
+}
+
+// Merge A[0 .. LEFT_SIZE - 1] and A[LEFT_SIZE .. SIZE - 1], each
+// sorted, through TEMP, with THREADS threads, and return the number
+// of groups of equal keys, G.  If OFFSETS is NULL, A[0 .. G - 1] is
+// set to the first key of each group, else A is left sorted, and
+// OFFSETS[0 .. G] to the offset of each group in A, and SIZE.  If
+// COUNTS is not NULL, COUNTS[0 .. G - 1] is set to the size of each
+// group.  G may be as large as SIZE.
+static inline int
+merge_groups (int a[], int size, int left_size, int temp[], int counts[],
+	      int offsets[], int threads)
+{
+  if (size < GROUP_SPLIT_MIN || threads < 1)
+    threads = 1;
+  int first[threads + 1], lead[threads], t;
+  if (size == 0)
+    {
+      if (offsets != NULL)
+	offsets[0] = 0;
+      return 0;
+    }
+#ifdef _OPENMP
+#pragma omp parallel for num_threads (threads) schedule (static, 1)
+#endif
+  for (t = 0; t < threads; t++)
+    first[t + 1] = group_merge_part (a, size, left_size, temp,
+				     (long) size * t / threads,
+				     (long) size * (t + 1) / threads);
+  first[0] = 0;
+  for (t = 0; t < threads; t++)
+    first[t + 1] += first[t];
+#ifdef _OPENMP
+#pragma omp parallel for num_threads (threads) schedule (static, 1)
+#endif
+  for (t = 0; t < threads; t++)
+    lead[t] = group_copy_part (a, temp, counts, offsets,
+			       (long) size * t / threads,
+			       (long) size * (t + 1) / threads, first[t]);
+  // The pieces of groups that span parts
+  if (counts != NULL)
+    for (t = 1; t < threads; t++)
+      if (lead[t] > 0)
+	counts[first[t] - 1] += lead[t];
+  if (offsets != NULL)
+    offsets[first[threads]] = size;
+  return first[threads];
+}
+
+#endif /* SORT_GROUP_H */
@@ -0,0 +1,82 @@
+/* Input distributions for the merge sort benchmarks.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "sort_input.h"
+
+const char *const sort_dist_name[DIST_N] = {
+  "random", "uniform", "sorted", "reverse", "nearly_sorted", "few_unique"
+};
+
+int
+sort_dist_lookup (const char *name)
+{
+  int dist;
+  for (dist = 0; dist < DIST_N; dist++)
+    if (strcmp (name, sort_dist_name[dist]) == 0)
+      return dist;
+  return -1;
+}
+
+// Every distribution is seeded identically, so that repeated
+// runs sort the same input.
+void
+sort_input_fill (int a[], int size, int dist)
+{
+  int i;
+  srand (314159);
+  switch (dist)
+    {
+    case DIST_RANDOM:
+      for (i = 0; i < size; i++)
+	a[i] = rand () % size;
+      break;
+    case DIST_UNIFORM:
+      for (i = 0; i < size; i++)
+	a[i] = (int) ((((unsigned) rand () << 16) ^ (unsigned) rand ())
+		      & INT_MAX);
+      break;
+    case DIST_SORTED:
+      for (i = 0; i < size; i++)
+	a[i] = i;
+      break;
+    case DIST_REVERSE:
+      for (i = 0; i < size; i++)
+	a[i] = size - i;
+      break;
+    case DIST_NEARLY_SORTED:
+      for (i = 0; i < size; i++)
+	a[i] = i;
+      for (i = 0; i < size / 100; i++)
+	{
+	  int j = rand () % size, k = rand () % size;
+	  int t = a[j];
+	  a[j] = a[k];
+	  a[k] = t;
+	}
+      break;
+    case DIST_FEW_UNIQUE:
+      for (i = 0; i < size; i++)
+	a[i] = rand () % 16;
+      break;
+    }
+}
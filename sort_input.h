@@ -0,0 +1,45 @@
+/* Input distributions for the merge sort benchmarks.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef SORT_INPUT_H
+#define SORT_INPUT_H
+
+// "random" is the input that every driver generates:
+// srand (314159) followed by rand () % size.  The others
+// exercise the best and worst cases of the merge and of the
+// insertion sort at the leaves.
+
+enum sort_dist
+{
+  DIST_RANDOM,			// rand () % size, as the drivers do
+  DIST_UNIFORM,			// Uniform over [0, INT_MAX]
+  DIST_SORTED,
+  DIST_REVERSE,
+  DIST_NEARLY_SORTED,		// Sorted, with 1% of the elements swapped
+  DIST_FEW_UNIQUE,		// 16 distinct keys
+  DIST_N
+};
+
+extern const char *const sort_dist_name[DIST_N];
+// Returns the distribution called NAME, or -1.
+extern int sort_dist_lookup (const char *name);
+extern void sort_input_fill (int a[], int size, int dist);
+
+#endif /* SORT_INPUT_H */
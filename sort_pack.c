@@ -0,0 +1,210 @@
+/* Compressed transfer of sorted runs.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+// Each block of PACK_BLOCK keys is stored as
+//
+//   the key before the block (for the first block, its first key),
+//     4 bytes;
+//   the bit width W of the largest difference between successive
+//     keys, 1 byte;
+//   the differences, in 4 W 32-bit words.
+//
+// Differences are taken modulo 2^32, so that any keys round trip.
+// The words are laid out for 4-lane SIMD: difference I of the block
+// is in lane I % 4, at bit offset (I / 4) W of the lane, whose words
+// are every fourth one.  So each step of the packing and unpacking
+// loops shifts the 4 lanes by the same amount, which the compiler
+// turns into one vector operation.  The last block is padded with
+// zero differences.
+
+#include <stdint.h>
+#include <string.h>
+#include "sort_pack.h"
+
+#define LANES 4
+#define HEADER 5
+
+// Keys packed before deciding whether packing pays
+#define PACK_SAMPLE (512 * PACK_BLOCK)
+
+extern double get_time (void);
+
+size_t
+pack_bound (int n)
+{
+  size_t blocks = (n + PACK_BLOCK - 1) / PACK_BLOCK;
+  return blocks * (HEADER + PACK_BLOCK * sizeof (uint32_t));
+}
+
+// Pack the differences D[0 .. PACK_BLOCK - 1], of at most WIDTH
+// bits, into W[0 .. LANES * WIDTH - 1].  Inlined for each constant
+// WIDTH, so that the loops unroll into vector shifts and ors.
+static inline __attribute__ ((always_inline)) void
+pack_block_width (const uint32_t d[], uint32_t w[], const int width)
+{
+  int j, lane, bit = 0;
+  for (j = 0; j < LANES * width; j++)
+    w[j] = 0;
+#pragma GCC unroll 32
+  for (j = 0; j < PACK_BLOCK / LANES; j++, bit += width)
+    {
+      int word = bit >> 5, shift = bit & 31;
+      for (lane = 0; lane < LANES; lane++)
+	w[LANES * word + lane] |= d[LANES * j + lane] << shift;
+      if (shift + width > 32)
+	for (lane = 0; lane < LANES; lane++)
+	  w[LANES * (word + 1) + lane] |= d[LANES * j + lane] >> (32 - shift);
+    }
+}
+
+static inline __attribute__ ((always_inline)) void
+unpack_block_width (const uint32_t w[], uint32_t d[], const int width)
+{
+  int j, lane, bit = 0;
+  const uint32_t mask = width == 32 ? ~0u : (1u << width) - 1;
+#pragma GCC unroll 32
+  for (j = 0; j < PACK_BLOCK / LANES; j++, bit += width)
+    {
+      int word = bit >> 5, shift = bit & 31;
+      for (lane = 0; lane < LANES; lane++)
+	{
+	  uint32_t v = w[LANES * word + lane] >> shift;
+	  if (shift + width > 32)
+	    v |= w[LANES * (word + 1) + lane] << (32 - shift);
+	  d[LANES * j + lane] = v & mask;
+	}
+    }
+}
+
+#define WIDTH_CASES(f, x, y) \
+  case 1: f (x, y, 1); break; case 2: f (x, y, 2); break; \
+  case 3: f (x, y, 3); break; case 4: f (x, y, 4); break; \
+  case 5: f (x, y, 5); break; case 6: f (x, y, 6); break; \
+  case 7: f (x, y, 7); break; case 8: f (x, y, 8); break; \
+  case 9: f (x, y, 9); break; case 10: f (x, y, 10); break; \
+  case 11: f (x, y, 11); break; case 12: f (x, y, 12); break; \
+  case 13: f (x, y, 13); break; case 14: f (x, y, 14); break; \
+  case 15: f (x, y, 15); break; case 16: f (x, y, 16); break; \
+  case 17: f (x, y, 17); break; case 18: f (x, y, 18); break; \
+  case 19: f (x, y, 19); break; case 20: f (x, y, 20); break; \
+  case 21: f (x, y, 21); break; case 22: f (x, y, 22); break; \
+  case 23: f (x, y, 23); break; case 24: f (x, y, 24); break; \
+  case 25: f (x, y, 25); break; case 26: f (x, y, 26); break; \
+  case 27: f (x, y, 27); break; case 28: f (x, y, 28); break; \
+  case 29: f (x, y, 29); break; case 30: f (x, y, 30); break; \
+  case 31: f (x, y, 31); break; case 32: f (x, y, 32); break
+
+static void
+pack_block (const uint32_t d[], int width, uint32_t w[])
+{
+  switch (width)
+    {
+      WIDTH_CASES (pack_block_width, d, w);
+    }
+}
+
+static void
+unpack_block (const uint32_t w[], int width, uint32_t d[])
+{
+  switch (width)
+    {
+    case 0:
+      memset (d, 0, PACK_BLOCK * sizeof (uint32_t));
+      break;
+      WIDTH_CASES (unpack_block_width, w, d);
+    }
+}
+
+// Pack blocks FIRST .. LAST - 1 of the N keys of A at OUT; returns
+// the bytes used.
+static size_t
+pack_blocks (const int a[], int n, int first, int last, unsigned char *out)
+{
+  uint32_t d[PACK_BLOCK], w[LANES * 32];
+  unsigned char *o = out;
+  int b;
+  for (b = first; b < last; b++)
+    {
+      int lo = b * PACK_BLOCK, m = n - lo < PACK_BLOCK ? n - lo : PACK_BLOCK;
+      int base = lo > 0 ? a[lo - 1] : a[0], i, width;
+      uint32_t any = 0;
+      const uint32_t *k = (const uint32_t *) a + lo;
+      d[0] = k[0] - (uint32_t) base;
+      for (i = 1; i < m; i++)
+	d[i] = k[i] - k[i - 1];
+      for (i = m; i < PACK_BLOCK; i++)
+	d[i] = 0;
+      for (i = 0; i < PACK_BLOCK; i++)
+	any |= d[i];
+      width = any ? 32 - __builtin_clz (any) : 0;
+      pack_block (d, width, w);
+      memcpy (o, &base, sizeof (base));
+      o[4] = width;
+      memcpy (o + HEADER, w, LANES * width * sizeof (uint32_t));
+      o += HEADER + LANES * width * sizeof (uint32_t);
+    }
+  return o - out;
+}
+
+// Pack the N keys of A into OUT, which holds pack_bound (N) bytes;
+// returns the bytes used.  If BANDWIDTH is not 0, first pack a
+// sample, and return 0 if sending A raw over a link of BANDWIDTH
+// bytes/second would be quicker than packing, sending and unpacking
+// it.
+size_t
+pack_sorted (const int a[], int n, unsigned char *out, double bandwidth)
+{
+  int blocks = (n + PACK_BLOCK - 1) / PACK_BLOCK, sample = 0;
+  size_t len = 0;
+  if (bandwidth > 0.0 && blocks > PACK_SAMPLE / PACK_BLOCK)
+    {
+      sample = PACK_SAMPLE / PACK_BLOCK;
+      double start = get_time ();
+      len = pack_blocks (a, n, 0, sample, out);
+      double t = get_time () - start;
+      double raw = (double) PACK_SAMPLE * sizeof (int);
+      // Unpacking is taken to cost as much as packing.
+      if (raw / bandwidth <= 2.0 * t + len / bandwidth)
+	return 0;
+    }
+  return len + pack_blocks (a, n, sample, blocks, out + len);
+}
+
+// Unpack the N keys packed at IN into A.
+void
+unpack_sorted (const unsigned char *in, int n, int a[])
+{
+  uint32_t d[PACK_BLOCK], w[LANES * 32];
+  int lo;
+  for (lo = 0; lo < n; lo += PACK_BLOCK)
+    {
+      int m = n - lo < PACK_BLOCK ? n - lo : PACK_BLOCK, width = in[4], i;
+      uint32_t key;
+      memcpy (&key, in, sizeof (key));
+      memcpy (w, in + HEADER, LANES * width * sizeof (uint32_t));
+      in += HEADER + LANES * width * sizeof (uint32_t);
+      unpack_block (w, width, d);
+      for (i = 0; i < m; i++)
+	{
+	  key += d[i];
+	  a[lo + i] = key;
+	}
+    }
+}
@@ -0,0 +1,104 @@
+/* Compressed transfer of sorted runs.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef SORT_PACK_H
+#define SORT_PACK_H
+
+// The helpers of mpi_mergesort and hybrid_mergesort return sorted
+// runs, whose successive differences are small: N keys drawn from
+// [0, N) differ by 1 on average.  pack_sorted stores blocks of
+// PACK_BLOCK differences at the bit width of the largest, which
+// shrinks such runs about tenfold.  Any keys round trip, sorted or
+// not; unsorted keys just pack poorly.
+//
+// Whether a run is packed is set by the "compress" parameter of
+// sort_tune.h: 0 never, 1 when it pays, 2 always.  It pays when the
+// time saved on the wire exceeds that spent packing and unpacking:
+// the helper times the packing of a first sample of the run, and
+// compares with the bandwidth of the link to its parent, as it was
+// when the parent sent it the unsorted run.
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "sort_tune.h"
+
+// Keys per block; a multiple of the 4 lanes of the packed layout
+#define PACK_BLOCK 128
+
+extern size_t pack_bound (int n);
+extern size_t pack_sorted (const int a[], int n, unsigned char *out,
+			   double bandwidth);
+extern void unpack_sorted (const unsigned char *in, int n, int a[]);
+
+#ifdef MPI_VERSION
+// Packed runs are sent with tag TAG + 1.
+#define PACK_TAG(tag) ((tag) + 1)
+
+// Send the N keys of A to DEST, packed if sort_tune.compress and the
+// BANDWIDTH (bytes/second) of the link make it pay.  Returns the
+// bytes sent.
+static inline size_t
+pack_send_mpi (const int a[], int n, int dest, int tag, MPI_Comm comm,
+	       double bandwidth)
+{
+  unsigned char *buf = NULL;
+  size_t len = 0;
+  if (sort_tune.compress > 0 && n > 0)
+    buf = malloc (pack_bound (n));
+  if (buf != NULL)
+    len = pack_sorted (a, n, buf, sort_tune.compress > 1 ? 0.0 : bandwidth);
+  if (len > 0)
+    MPI_Send (buf, len, MPI_BYTE, dest, PACK_TAG (tag), comm);
+  else
+    {
+      len = n * sizeof (int);
+      MPI_Send (a, n, MPI_INT, dest, tag, comm);
+    }
+  free (buf);
+  return len;
+}
+
+// Receive the N keys sent by pack_send_mpi from SOURCE into A.
+static inline void
+pack_recv_mpi (int a[], int n, int source, int tag, MPI_Comm comm)
+{
+  MPI_Status status;
+  MPI_Probe (source, MPI_ANY_TAG, comm, &status);
+  if (status.MPI_TAG != PACK_TAG (tag))
+    {
+      MPI_Recv (a, n, MPI_INT, source, tag, comm, &status);
+      return;
+    }
+  int len;
+  MPI_Get_count (&status, MPI_BYTE, &len);
+  unsigned char *buf = malloc (len);
+  if (buf == NULL)
+    {
+      printf ("Error: Could not allocate buffer of %d bytes\n", len);
+      MPI_Abort (MPI_COMM_WORLD, 1);
+    }
+  MPI_Recv (buf, len, MPI_BYTE, source, PACK_TAG (tag), comm, &status);
+  unpack_sorted (buf, n, a);
+  free (buf);
+}
+#endif
+
+#endif /* SORT_PACK_H */
@@ -0,0 +1,81 @@
+/* Local merge sort service: protocol and client library.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef SORT_SERVICE_H
+#define SORT_SERVICE_H
+
+// sortd (sortd.c) is a long-running process that sorts int arrays
+// for local clients.  It keeps an OpenMP team (optionally pinned to
+// CPUs) and a scratch array warm between requests, so that a sort
+// pays neither process startup, nor team creation, nor the
+// allocation of its temporary array.
+//
+// A client places its array in a shared memory file (memfd), and
+// sends a request that carries the file descriptor over sortd's
+// Unix socket ($SORT_SOCKET, else /tmp/sortd.UID).  sortd maps the
+// file, sorts the array in place, and replies; no element is copied
+// through the socket.  Requests are served one at a time, each with
+// the whole team.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SORT_SERVICE_MAGIC 0x534f5254	// "SORT"
+
+enum sort_service_op
+{
+  SORT_OP_SORT = 1,		// Sort COUNT ints at OFFSET bytes in the file
+  SORT_OP_PING,			// No file; reply only
+  SORT_OP_SHUTDOWN		// No file; sortd exits after replying
+};
+
+// Sent as one SOCK_SEQPACKET message, with the file descriptor of
+// the array (SORT_OP_SORT only) as SCM_RIGHTS ancillary data.
+struct sort_request
+{
+  uint32_t magic;
+  uint32_t op;
+  uint64_t offset;		// Bytes; need not be page aligned
+  uint64_t count;		// Elements
+};
+
+struct sort_reply
+{
+  uint32_t magic;
+  int32_t status;		// 0, or an errno value
+  double elapsed;		// Seconds spent sorting, in sortd
+};
+
+extern const char *sort_service_path (char *buf, size_t len);
+extern int sort_service_connect (const char *path);
+extern int *sort_service_alloc (size_t count, int *fd);
+extern void sort_service_free (int *a, size_t count, int fd);
+extern int sort_service_call (int sock, uint32_t op, int fd,
+			      size_t offset, size_t count, double *elapsed);
+
+// Sort the COUNT elements of A, which sort_service_alloc returned
+// with FD, in place.  Returns 0 or an errno value.
+static inline int
+sort_service_sort (int sock, int fd, size_t count, double *elapsed)
+{
+  return sort_service_call (sock, SORT_OP_SORT, fd, 0, count, elapsed);
+}
+
+#endif /* SORT_SERVICE_H */
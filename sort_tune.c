@@ -0,0 +1,147 @@
+/* Tuning parameters of the merge sort drivers, and per-host profiles.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "sort_tune.h"
+
+struct sort_tune sort_tune = SORT_TUNE_DEFAULT;
+
+static const struct
+{
+  const char *name;
+  size_t offset;
+  int min;
+} tune_param[] = {
+  {"small", offsetof (struct sort_tune, small), 1},
+  {"task_cutoff", offsetof (struct sort_tune, task_cutoff), 0},
+  {"hybrid_threads", offsetof (struct sort_tune, hybrid_threads), 0},
+  {"block_min", offsetof (struct sort_tune, block_min), 0},
+  {"compress", offsetof (struct sort_tune, compress), 0},
+  {"streams", offsetof (struct sort_tune, streams), 0},
+};
+
+#define N_PARAMS ((int) (sizeof (tune_param) / sizeof (tune_param[0])))
+
+#define PARAM(tune, i) (*(int *) ((char *) (tune) + tune_param[i].offset))
+
+// The profile of this host, or NULL if profiles are disabled.
+const char *
+tune_profile_name (char *buf, size_t len)
+{
+  char host[256];
+  const char *name = getenv ("SORT_PROFILE");
+  if (name != NULL)
+    return *name ? name : NULL;
+  const char *home = getenv ("HOME");
+  if (home == NULL || gethostname (host, sizeof (host)) != 0)
+    return NULL;
+  host[sizeof (host) - 1] = '\0';
+  snprintf (buf, len, "%s/.sort_profile/%s", home, host);
+  return buf;
+}
+
+// Read the parameters of FILE into TUNE.  Returns 0 if FILE does not
+// exist, -1 if it is malformed, else 1.
+int
+tune_read (const char *file, struct sort_tune *tune)
+{
+  char line[256], name[64];
+  int value, lineno = 0, ok = 1;
+  FILE *f = fopen (file, "r");
+  if (f == NULL)
+    {
+      if (errno != ENOENT)
+	perror (file);
+      return errno == ENOENT ? 0 : -1;
+    }
+  while (fgets (line, sizeof (line), f) != NULL)
+    {
+      int i;
+      lineno++;
+      line[strcspn (line, "#\n")] = '\0';
+      if (line[strspn (line, " \t")] == '\0')
+	continue;
+      if (sscanf (line, " %63[a-z_] = %d", name, &value) != 2)
+	{
+	  fprintf (stderr, "%s:%d: syntax error\n", file, lineno);
+	  ok = 0;
+	  continue;
+	}
+      for (i = 0; i < N_PARAMS; i++)
+	if (strcmp (name, tune_param[i].name) == 0)
+	  break;
+      if (i == N_PARAMS || value < tune_param[i].min)
+	{
+	  fprintf (stderr, "%s:%d: %s parameter: %s\n", file, lineno,
+		   i == N_PARAMS ? "unknown" : "invalid", name);
+	  ok = 0;
+	  continue;
+	}
+      PARAM (tune, i) = value;
+    }
+  fclose (f);
+  return ok ? 1 : -1;
+}
+
+// Write TUNE to FILE, creating its directory if need be.
+int
+tune_write (const char *file, const struct sort_tune *tune,
+	    const char *comment)
+{
+  char dir[4096];
+  int i;
+  snprintf (dir, sizeof (dir), "%s", file);
+  char *slash = strrchr (dir, '/');
+  if (slash != NULL && slash != dir)
+    {
+      *slash = '\0';
+      if (mkdir (dir, 0755) != 0 && errno != EEXIST)
+	{
+	  perror (dir);
+	  return 0;
+	}
+    }
+  FILE *f = fopen (file, "w");
+  if (f == NULL)
+    {
+      perror (file);
+      return 0;
+    }
+  if (comment != NULL)
+    fprintf (f, "# %s\n", comment);
+  for (i = 0; i < N_PARAMS; i++)
+    fprintf (f, "%s = %d\n", tune_param[i].name, PARAM (tune, i));
+  return fclose (f) == 0;
+}
+
+// Load this host's profile, if any, into sort_tune.
+void
+tune_load (void)
+{
+  char buf[4096];
+  const char *file = tune_profile_name (buf, sizeof (buf));
+  if (file != NULL && tune_read (file, &sort_tune) < 0)
+    fprintf (stderr, "Warning: %s: ignoring invalid parameters\n", file);
+}
@@ -0,0 +1,99 @@
+/* Tuning parameters of the merge sort drivers, and per-host profiles.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef SORT_TUNE_H
+#define SORT_TUNE_H
+
+// The drivers read their tuning parameters at startup from the
+// profile of the host they run on, which "bench -A" writes (see
+// bench_tune.c).  The profile is $SORT_PROFILE if that is set (an
+// empty value disables it), else ~/.sort_profile/HOSTNAME.  It holds
+// "name = value" lines; "#" starts a comment.  Parameters that are
+// missing keep the defaults below.
+
+#include <stddef.h>
+
+// Arrays size <= SMALL switches to insertion sort
+#define SMALL    32
+
+// Block sorts: below this many elements per rank (or UPC thread),
+// the whole array is sorted by rank 0.
+#define BLOCK_MIN 1024
+
+struct sort_tune
+{
+  int small;			// Leaf size; see SMALL
+  int task_cutoff;		// omp_mergesort: 0 to recurse with sections
+				// over threads, else OpenMP tasks down to
+				// this many elements
+  int hybrid_threads;		// OpenMP threads per rank, if not given;
+				// 0 if not tuned
+  int block_min;		// See BLOCK_MIN
+  int compress;			// mpi_mergesort, hybrid_mergesort: pack
+				// the sorted runs that helpers return; see
+				// sort_pack.h
+  int streams;			// hybrid_mergesort: segments per transfer,
+				// each by its own OpenMP thread, with
+				// MPI_THREAD_MULTIPLE; 0 or 1 for one
+};
+
+#define SORT_TUNE_DEFAULT { SMALL, 0, 0, BLOCK_MIN, 0, 0 }
+
+extern struct sort_tune sort_tune;
+
+extern const char *tune_profile_name (char *buf, size_t len);
+extern int tune_read (const char *file, struct sort_tune *tune);
+extern int tune_write (const char *file, const struct sort_tune *tune,
+		       const char *comment);
+extern void tune_load (void);
+
+#ifdef MPI_VERSION
+// Collective over COMM: rank 0 reads the profile, so that all ranks
+// agree on the parameters that shape the communication.
+static inline void
+tune_load_mpi (MPI_Comm comm)
+{
+  int rank;
+  MPI_Comm_rank (comm, &rank);
+  if (rank == 0)
+    tune_load ();
+  MPI_Bcast (&sort_tune, sizeof (sort_tune) / sizeof (int), MPI_INT, 0,
+	     comm);
+}
+#endif
+
+#ifdef __UPC__
+static shared struct sort_tune tune_shared;
+
+// Collective: thread 0 reads the profile.
+static inline void
+tune_load_upc (void)
+{
+  if (MYTHREAD == 0)
+    {
+      tune_load ();
+      tune_shared = sort_tune;
+    }
+  upc_barrier;
+  sort_tune = tune_shared;
+}
+#endif
+
+#endif /* SORT_TUNE_H */
@@ -0,0 +1,286 @@
+/* Result checks of the merge sort drivers.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef SORT_VALIDATE_H
+#define SORT_VALIDATE_H
+
+// A sorted result must be in order, and a permutation of the input.
+// The drivers take a checksum of the input before they sort, and
+// check the output in one pass that finds the first key out of order
+// and takes the same checksum.  The checksum is of the multiset of
+// keys, so it does not depend on their order: their sum, and the xor
+// of a hash of each, modulo 2^64.  A key lost, duplicated or
+// overwritten changes both, barring a 2^-64 coincidence.
+//
+// The pass runs on all OpenMP threads in programs built with OpenMP.
+// sort_validate_rma and sort_validate_upc split it over the ranks or
+// UPC threads, each of which reads its share of the array on rank 0
+// (thread 0) in chunks, and reduce the results there.
+//
+// Set SORT_VALIDATE=0 in the environment to skip the checks, as for
+// long benchmark runs.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+// Keys read at a time by sort_validate_rma and sort_validate_upc
+#define VALIDATE_CHUNK 65536
+
+struct sort_sum
+{
+  unsigned long long sum, hash;
+};
+
+struct sort_check
+{
+  struct sort_sum s;
+  long descent;			// First I with A[I - 1] > A[I], else LONG_MAX
+};
+
+#define SORT_CHECK_INIT { { 0, 0 }, LONG_MAX }
+
+static inline int
+sort_validate_enabled (void)
+{
+  const char *v = getenv ("SORT_VALIDATE");
+  return v == NULL || strcmp (v, "0") != 0;
+}
+
+// The splitmix64 finalizer
+static inline unsigned long long
+sort_hash (int x)
+{
+  unsigned long long z = (unsigned int) x + 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+// Add to C the keys A[SKIP .. N - 1], at INDEX .. of the array, and
+// check that A[0 .. N - 1] is in order.  SKIP is 1 if A[0] is the
+// key before INDEX, already added.
+static inline void
+sort_check_add (struct sort_check *c, const int a[], long n, long index,
+		int skip)
+{
+  unsigned long long sum = c->s.sum, hash = c->s.hash;
+  long descent = c->descent, i;
+#ifdef _OPENMP
+#pragma omp parallel for schedule (static) \
+  reduction (+:sum) reduction (^:hash) reduction (min:descent)
+#endif
+  for (i = skip; i < n; i++)
+    {
+      sum += (unsigned long long) a[i];
+      hash ^= sort_hash (a[i]);
+      if (i > 0 && a[i - 1] > a[i] && index + i - skip < descent)
+	descent = index + i - skip;
+    }
+  c->s.sum = sum;
+  c->s.hash = hash;
+  c->descent = descent;
+}
+
+static inline struct sort_sum
+sort_checksum (const int a[], long n)
+{
+  struct sort_check c = SORT_CHECK_INIT;
+  sort_check_add (&c, a, n, 0, 0);
+  return c.s;
+}
+
+// Print what is wrong, if C is not that of a sorted permutation of
+// the keys of checksum IN (if not NULL); returns 1 if nothing is.
+static inline int
+sort_check_report (const struct sort_check *c, const struct sort_sum *in)
+{
+  if (c->descent != LONG_MAX)
+    {
+      printf ("Implementation error: a[%ld] > a[%ld]\n", c->descent - 1,
+	      c->descent);
+      return 0;
+    }
+  if (in != NULL && (c->s.sum != in->sum || c->s.hash != in->hash))
+    {
+      printf ("Implementation error: result is not a permutation"
+	      " of the input (checksum %016llx:%016llx, not %016llx:%016llx)\n",
+	      c->s.sum, c->s.hash, in->sum, in->hash);
+      return 0;
+    }
+  return 1;
+}
+
+// Check that A[0 .. N - 1] is sorted and, if IN is not NULL, has the
+// keys of checksum IN.  Returns 1 if so, else prints what is wrong.
+static inline int
+sort_validate (const int a[], long n, const struct sort_sum *in)
+{
+  struct sort_check c = SORT_CHECK_INIT;
+  sort_check_add (&c, a, n, 0, 0);
+  return sort_check_report (&c, in);
+}
+
+// Check that KEYS[0 .. G - 1], the groups of a sort_unique or
+// sort_count, are strictly increasing and, if COUNTS is not NULL,
+// that each key is counted at least once and, if IN is not NULL, that
+// the keys so counted are those of checksum IN.  Returns 1 if so,
+// else prints what is wrong.
+static inline int
+sort_validate_counts (const int keys[], const int counts[], long g,
+		      const struct sort_sum *in)
+{
+  struct sort_check c = SORT_CHECK_INIT;
+  long i;
+  for (i = 0; i < g; i++)
+    {
+      if (i > 0 && keys[i - 1] >= keys[i])
+	{
+	  printf ("Implementation error: key[%ld] >= key[%ld]\n", i - 1, i);
+	  return 0;
+	}
+      if (counts == NULL)
+	continue;
+      if (counts[i] <= 0)
+	{
+	  printf ("Implementation error: count[%ld] = %d\n", i, counts[i]);
+	  return 0;
+	}
+      c.s.sum += (unsigned long long) keys[i] * counts[i];
+      if (counts[i] & 1)
+	c.s.hash ^= sort_hash (keys[i]);
+    }
+  return sort_check_report (&c, counts != NULL ? in : NULL);
+}
+
+// Check that OFFSETS[0 .. G] are those of the G groups of equal keys
+// of A[0 .. N - 1], sorted, and then N.  Returns 1 if so, else prints
+// what is wrong.
+static inline int
+sort_validate_offsets (const int a[], long n, const int offsets[], long g)
+{
+  long i;
+  if (offsets[0] != 0 || offsets[g] != n)
+    {
+      printf ("Implementation error: offsets %d .. %d, not 0 .. %ld\n",
+	      offsets[0], offsets[g], n);
+      return 0;
+    }
+  for (i = 0; i < g; i++)
+    if (offsets[i] >= offsets[i + 1]
+	|| (i > 0 && a[offsets[i] - 1] == a[offsets[i]])
+	|| a[offsets[i + 1] - 1] != a[offsets[i]])
+      {
+	printf ("Implementation error: group %ld at offsets %d .. %d\n", i,
+		offsets[i], offsets[i + 1]);
+	return 0;
+      }
+  return 1;
+}
+
+#ifdef MPI_VERSION
+// Collective over COMM: sort_validate of the N keys at displacement
+// 0 of rank 0's memory in WIN, which all ranks have locked (as by
+// MPI_Win_lock_all).  IN is significant on rank 0, and so is the
+// result; the other ranks return 1.
+static inline int
+sort_validate_rma (MPI_Win win, long n, const struct sort_sum *in,
+		   MPI_Comm comm)
+{
+  int comm_size, rank;
+  MPI_Comm_size (comm, &comm_size);
+  MPI_Comm_rank (comm, &rank);
+  long lo = n * rank / comm_size, hi = n * (rank + 1) / comm_size, i;
+  struct sort_check c = SORT_CHECK_INIT;
+  int *buf = malloc (sizeof (int) * (VALIDATE_CHUNK + 1));
+  // Make rank 0's stores to its memory visible to the others
+  MPI_Win_sync (win);
+  MPI_Barrier (comm);
+  if (buf == NULL)
+    {
+      printf ("Error: Could not allocate array of size %d\n",
+	      VALIDATE_CHUNK + 1);
+      MPI_Abort (MPI_COMM_WORLD, 1);
+    }
+  for (i = lo; i < hi; i += VALIDATE_CHUNK)
+    {
+      // With the key before the chunk, to check the order across
+      long first = i > 0 ? i - 1 : 0;
+      long m = (i + VALIDATE_CHUNK < hi ? i + VALIDATE_CHUNK : hi) - first;
+      MPI_Get (buf, m, MPI_INT, 0, first, m, MPI_INT, win);
+      MPI_Win_flush (0, win);
+      sort_check_add (&c, buf, m, i, i > first);
+    }
+  free (buf);
+  struct sort_check all;
+  MPI_Reduce (&c.s.sum, &all.s.sum, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0,
+	      comm);
+  MPI_Reduce (&c.s.hash, &all.s.hash, 1, MPI_UNSIGNED_LONG_LONG, MPI_BXOR, 0,
+	      comm);
+  MPI_Reduce (&c.descent, &all.descent, 1, MPI_LONG, MPI_MIN, 0, comm);
+  return rank != 0 || sort_check_report (&all, in);
+}
+#endif
+
+#ifdef __UPC__
+static shared struct sort_check validate_shared[THREADS];
+
+// Collective: sort_validate of A[0 .. N - 1], on thread 0.  IN is
+// significant on thread 0, and so is the result; the other threads
+// return 1.
+static inline int
+sort_validate_upc (shared [] int *a, long n, const struct sort_sum *in)
+{
+  long lo = n * MYTHREAD / THREADS, hi = n * (MYTHREAD + 1) / THREADS, i;
+  struct sort_check c = SORT_CHECK_INIT;
+  int *buf = malloc (sizeof (int) * (VALIDATE_CHUNK + 1));
+  if (buf == NULL)
+    {
+      printf ("Error: Could not allocate array of size %d\n",
+	      VALIDATE_CHUNK + 1);
+      upc_global_exit (1);
+    }
+  for (i = lo; i < hi; i += VALIDATE_CHUNK)
+    {
+      long first = i > 0 ? i - 1 : 0;
+      long m = (i + VALIDATE_CHUNK < hi ? i + VALIDATE_CHUNK : hi) - first;
+      upc_memget (buf, a + first, m * sizeof (int));
+      sort_check_add (&c, buf, m, i, i > first);
+    }
+  free (buf);
+  validate_shared[MYTHREAD] = c;
+  upc_barrier;
+  if (MYTHREAD != 0)
+    return 1;
+  struct sort_check all = SORT_CHECK_INIT;
+  for (i = 0; i < THREADS; i++)
+    {
+      struct sort_check t = validate_shared[i];
+      all.s.sum += t.s.sum;
+      all.s.hash ^= t.s.hash;
+      if (t.descent < all.descent)
+	all.descent = t.descent;
+    }
+  return sort_check_report (&all, in);
+}
+#endif
+
+#endif /* SORT_VALIDATE_H */
@@ -0,0 +1,113 @@
+/* Client of the local merge sort service.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+// Sorts an array of each size given, -r times, through sortd, and
+// checks the result.  Prints the time of each sort as measured by
+// sortd, and the round trip as seen by the client.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "sort_input.h"
+#include "sort_service.h"
+#include "sort_validate.h"
+
+extern double get_time (void);
+
+static void
+usage (const char *prog)
+{
+  printf ("Usage: %s [-s socket] [-d dist] [-r reps] size ...\n"
+	  "       %s [-s socket] -x\n"
+	  "  -s SOCKET  sortd's socket (default: $SORT_SOCKET, else"
+	  " /tmp/sortd.UID)\n"
+	  "  -d DIST    input distribution (default: random)\n"
+	  "  -r REPS    sorts of each size (default: 1)\n"
+	  "  -x         stop sortd\n", prog, prog);
+}
+
+int
+main (int argc, char *argv[])
+{
+  char buf[108];
+  const char *path = sort_service_path (buf, sizeof (buf));
+  int dist = DIST_RANDOM, reps = 1, stop = 0, status = 0, c, i, rep;
+  while ((c = getopt (argc, argv, "s:d:r:xh")) != -1)
+    switch (c)
+      {
+      case 's':
+	path = optarg;
+	break;
+      case 'd':
+	dist = sort_dist_lookup (optarg);
+	break;
+      case 'r':
+	reps = atoi (optarg);
+	break;
+      case 'x':
+	stop = 1;
+	break;
+      default:
+	usage (argv[0]);
+	return 2;
+      }
+  if (dist < 0 || reps < 1 || (optind == argc) != stop)
+    {
+      usage (argv[0]);
+      return 2;
+    }
+  int sock = sort_service_connect (path);
+  if (sock < 0)
+    return 1;
+  if (stop)
+    return sort_service_call (sock, SORT_OP_SHUTDOWN, -1, 0, 0, NULL) != 0;
+  for (i = optind; i < argc; i++)
+    {
+      int size = atoi (argv[i]), fd;
+      int *a = sort_service_alloc (size, &fd);
+      if (a == NULL)
+	return 1;
+      printf ("Array size = %d\n", size);
+      for (rep = 0; rep < reps; rep++)
+	{
+	  double elapsed, start;
+	  int validate = sort_validate_enabled ();
+	  struct sort_sum in = { 0, 0 };
+	  sort_input_fill (a, size, dist);
+	  if (validate)
+	    in = sort_checksum (a, size);
+	  start = get_time ();
+	  int err = sort_service_sort (sock, fd, size, &elapsed);
+	  double round_trip = get_time () - start;
+	  if (err != 0)
+	    {
+	      printf ("Error: sortd: %s\n", strerror (err));
+	      return 1;
+	    }
+	  if (validate && !sort_validate (a, size, &in))
+	    status = 1;
+	  printf ("Elapsed = %.6f\nRound trip = %.6f\n", elapsed, round_trip);
+	}
+      sort_service_free (a, size, fd);
+    }
+  close (sock);
+  return status;
+}
@@ -0,0 +1,318 @@
+/* Local merge sort service.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+// See sort_service.h.  Requests are sorted by the task-based OpenMP
+// merge sort of msort.c; its team of threads is created once, on
+// startup, and reused by every request (the OpenMP runtime keeps
+// the threads of a team of unchanged size).  The scratch array only
+// grows, and its pages are touched when it does, so that requests
+// do not page fault on it.  With -a, each request is sorted by the
+// engine that a sample of its keys suggests (see msort_dispatch.c),
+// and the choice is logged.
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <omp.h>
+#include "msort.h"
+#include "sort_tune.h"
+#include "sort_service.h"
+
+#define MAX_CLIENTS 64
+
+// Task cutoff when the host's profile does not set one
+#define DEFAULT_TASK_CUTOFF 16384
+
+extern double get_time (void);
+
+static volatile sig_atomic_t sortd_stop;
+static int *scratch;
+static size_t scratch_count;
+static int threads;
+static int dispatch;
+
+static void
+sortd_signal (int sig)
+{
+  (void) sig;
+  sortd_stop = 1;
+}
+
+// Bind each thread of the team to one of the CPUs that this process
+// may run on, round robin.
+static void
+pin_team (void)
+{
+  cpu_set_t allowed;
+  int cpus[CPU_SETSIZE], n_cpus = 0, cpu;
+  if (sched_getaffinity (0, sizeof (allowed), &allowed) != 0)
+    {
+      perror ("sched_getaffinity");
+      return;
+    }
+  for (cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    if (CPU_ISSET (cpu, &allowed))
+      cpus[n_cpus++] = cpu;
+#pragma omp parallel num_threads (threads)
+  {
+    cpu_set_t set;
+    CPU_ZERO (&set);
+    CPU_SET (cpus[omp_get_thread_num () % n_cpus], &set);
+    if (sched_setaffinity (0, sizeof (set), &set) != 0)
+      perror ("sched_setaffinity");
+  }
+}
+
+// Grow the scratch array to COUNT elements.  Returns 0 on failure.
+static int
+reserve_scratch (size_t count)
+{
+  if (count <= scratch_count)
+    return 1;
+  int *p = realloc (scratch, count * sizeof (int));
+  if (p == NULL)
+    return 0;
+  scratch = p;
+  // Fault the new pages in, from the team, so that they are placed
+  // near the threads that will use them.
+  size_t from = scratch_count;
+#pragma omp parallel for num_threads (threads) schedule (static)
+  for (size_t i = from; i < count; i++)
+    scratch[i] = 0;
+  scratch_count = count;
+  return 1;
+}
+
+static int
+sort_file (int fd, uint64_t offset, uint64_t count, double *elapsed)
+{
+  struct stat st;
+  if (count > (uint64_t) INT32_MAX)
+    return EOVERFLOW;
+  size_t end = offset + count * sizeof (int);
+  if (fstat (fd, &st) != 0)
+    return errno;
+  if (end < offset || (uint64_t) st.st_size < end)
+    return EINVAL;
+  if (count == 0)
+    return 0;
+  if (!reserve_scratch (count))
+    return ENOMEM;
+  void *base = mmap (NULL, end, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED)
+    return errno;
+  int *a = (int *) ((char *) base + offset);
+  struct sort_choice c;
+  double start = get_time ();
+  if (dispatch)
+    sort_dispatch_omp (a, (int) count, scratch, threads, &c);
+  else
+    run_omp (a, (int) count, scratch, threads);
+  *elapsed = get_time () - start;
+  if (dispatch)
+    {
+      printf ("Sorted %lu keys with %s in %.6f s (%s)\n",
+	      (unsigned long) count, sort_engine_name[c.engine], *elapsed,
+	      c.reason);
+      fflush (stdout);
+    }
+  munmap (base, end);
+  return 0;
+}
+
+// Serve one request from SOCK.  Returns 0 when the client has gone.
+static int
+serve (int sock)
+{
+  struct sort_request req;
+  struct sort_reply reply = { SORT_SERVICE_MAGIC, 0, 0.0 };
+  union
+  {
+    char buf[CMSG_SPACE (sizeof (int))];
+    struct cmsghdr align;
+  } control;
+  struct iovec iov = { &req, sizeof (req) };
+  struct msghdr msg;
+  int fd = -1;
+  memset (&msg, 0, sizeof (msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.buf;
+  msg.msg_controllen = sizeof (control.buf);
+  ssize_t n = recvmsg (sock, &msg, MSG_CMSG_CLOEXEC);
+  if (n <= 0)
+    return 0;
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR (&msg);
+  if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET
+      && cmsg->cmsg_type == SCM_RIGHTS)
+    memcpy (&fd, CMSG_DATA (cmsg), sizeof (int));
+  if (n != (ssize_t) sizeof (req) || req.magic != SORT_SERVICE_MAGIC)
+    reply.status = EPROTO;
+  else if (req.op == SORT_OP_SORT)
+    reply.status = fd < 0 ? EBADF
+      : sort_file (fd, req.offset, req.count, &reply.elapsed);
+  else if (req.op == SORT_OP_SHUTDOWN)
+    sortd_stop = 1;
+  else if (req.op != SORT_OP_PING)
+    reply.status = EINVAL;
+  if (fd >= 0)
+    close (fd);
+  return send (sock, &reply, sizeof (reply), MSG_NOSIGNAL)
+    == (ssize_t) sizeof (reply);
+}
+
+static void
+usage (const char *prog)
+{
+  printf ("Usage: %s [-s socket] [-t threads] [-m elements] [-u] [-a]\n"
+	  "  -s SOCKET    listen on SOCKET (default: $SORT_SOCKET, else"
+	  " /tmp/sortd.UID)\n"
+	  "  -t THREADS   threads in the team (default: OpenMP's)\n"
+	  "  -m ELEMENTS  size the scratch array for ELEMENTS up front\n"
+	  "  -u           leave the threads unpinned\n"
+	  "  -a           pick the engine of each request by a sample of its"
+	  " keys\n", prog);
+}
+
+int
+main (int argc, char *argv[])
+{
+  char buf[108];
+  const char *path = sort_service_path (buf, sizeof (buf));
+  long reserve = 0;
+  int pin = 1, c;
+  threads = omp_get_max_threads ();
+  while ((c = getopt (argc, argv, "s:t:m:uah")) != -1)
+    switch (c)
+      {
+      case 's':
+	path = optarg;
+	break;
+      case 't':
+	threads = atoi (optarg);
+	break;
+      case 'm':
+	reserve = atol (optarg);
+	break;
+      case 'u':
+	pin = 0;
+	break;
+      case 'a':
+	dispatch = 1;
+	break;
+      default:
+	usage (argv[0]);
+	return 2;
+      }
+  if (optind != argc || threads < 1 || reserve < 0)
+    {
+      usage (argv[0]);
+      return 2;
+    }
+  // Tuning parameters of this host
+  tune_load ();
+  if (sort_tune.task_cutoff == 0)
+    sort_tune.task_cutoff = DEFAULT_TASK_CUTOFF;
+  if (pin)
+    pin_team ();
+  if (!reserve_scratch (reserve))
+    {
+      printf ("Error: Could not allocate array of size %ld\n", reserve);
+      return 1;
+    }
+
+  struct sockaddr_un addr;
+  int listener = socket (AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if (listener < 0)
+    {
+      perror ("socket");
+      return 1;
+    }
+  memset (&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  snprintf (addr.sun_path, sizeof (addr.sun_path), "%s", path);
+  unlink (path);
+  if (bind (listener, (struct sockaddr *) &addr, sizeof (addr)) != 0
+      || listen (listener, MAX_CLIENTS) != 0)
+    {
+      perror (path);
+      return 1;
+    }
+  struct sigaction sa;
+  memset (&sa, 0, sizeof (sa));
+  sa.sa_handler = sortd_signal;
+  sigaction (SIGINT, &sa, NULL);
+  sigaction (SIGTERM, &sa, NULL);
+  printf ("Listening on %s\nThreads = %d%s\nTask cutoff = %d\n", path,
+	  threads, pin ? " (pinned)" : "", sort_tune.task_cutoff);
+  fflush (stdout);
+
+  struct pollfd pfd[1 + MAX_CLIENTS];
+  int n_clients = 0, i;
+  pfd[0].fd = listener;
+  pfd[0].events = POLLIN;
+  while (!sortd_stop)
+    {
+      if (poll (pfd, 1 + n_clients, -1) < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  perror ("poll");
+	  break;
+	}
+      for (i = 1; i <= n_clients && !sortd_stop; i++)
+	if (pfd[i].revents && !serve (pfd[i].fd))
+	  {
+	    close (pfd[i].fd);
+	    pfd[i--] = pfd[n_clients--];
+	  }
+      if (pfd[0].revents & POLLIN)
+	{
+	  int sock = accept4 (listener, NULL, NULL, SOCK_CLOEXEC);
+	  if (sock < 0)
+	    perror ("accept");
+	  else if (n_clients == MAX_CLIENTS)
+	    close (sock);
+	  else
+	    {
+	      n_clients++;
+	      pfd[n_clients].fd = sock;
+	      pfd[n_clients].events = POLLIN;
+	      pfd[n_clients].revents = 0;
+	    }
+	}
+    }
+  for (i = 1; i <= n_clients; i++)
+    close (pfd[i].fd);
+  close (listener);
+  unlink (path);
+  free (scratch);
+  return 0;
+}
@@ -0,0 +1,197 @@
+/* Chrome/Perfetto timeline traces of the merge sort drivers.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "instrument.h"
+
+// Upper bound on the number of distinct threads that may record
+// events during one run (nested OpenMP teams included).
+#define TRACE_MAX_THREADS 1024
+
+struct trace_event
+{
+  double t0, t1, bytes;
+  int slot;
+};
+
+struct trace_ring
+{
+  unsigned long n_events;	// Total recorded, including overwritten
+  struct trace_event event[TRACE_RING_EVENTS];
+};
+
+static struct trace_ring *trace_table[TRACE_MAX_THREADS];
+static int trace_n_threads;
+static __thread struct trace_ring *trace_self;
+static double trace_offset, trace_base;
+
+static struct trace_ring *
+trace_thread_ring (void)
+{
+  int id = __atomic_fetch_add (&trace_n_threads, 1, __ATOMIC_RELAXED);
+  if (id >= TRACE_MAX_THREADS)
+    {
+      fprintf (stderr, "Error: more than %d traced threads\n",
+	       TRACE_MAX_THREADS);
+      abort ();
+    }
+  struct trace_ring *ring = calloc (1, sizeof (struct trace_ring));
+  if (ring == NULL)
+    {
+      perror ("trace_thread_ring");
+      abort ();
+    }
+  __atomic_store_n (&trace_table[id], ring, __ATOMIC_RELEASE);
+  trace_self = ring;
+  return ring;
+}
+
+void
+trace_record (int slot, double t0, double t1, double bytes)
+{
+  struct trace_ring *ring = trace_self ? trace_self : trace_thread_ring ();
+  struct trace_event *e = &ring->event[ring->n_events % TRACE_RING_EVENTS];
+  e->t0 = t0;
+  e->t1 = t1;
+  e->bytes = bytes;
+  e->slot = slot;
+  ring->n_events++;
+}
+
+// Earliest time stamp still held in this process's rings.
+double
+trace_start_time (void)
+{
+  int n_threads = __atomic_load_n (&trace_n_threads, __ATOMIC_ACQUIRE);
+  double start = get_time ();
+  for (int t = 0; t < n_threads; t++)
+    {
+      struct trace_ring *ring =
+	__atomic_load_n (&trace_table[t], __ATOMIC_ACQUIRE);
+      if (ring == NULL)
+	continue;
+      unsigned long n = ring->n_events < TRACE_RING_EVENTS
+	? ring->n_events : TRACE_RING_EVENTS;
+      for (unsigned long i = 0; i < n; i++)
+	if (ring->event[i].t0 < start)
+	  start = ring->event[i].t0;
+    }
+  return start;
+}
+
+void
+trace_set_clock (double offset, double base)
+{
+  trace_offset = offset;
+  trace_base = base;
+}
+
+static const char *
+trace_file_name (void)
+{
+  const char *name = getenv ("SORT_TRACE_FILE");
+  return (name && *name) ? name : "sort_trace.json";
+}
+
+static FILE *
+trace_open (const char *name, const char *mode)
+{
+  FILE *f = fopen (name, mode);
+  if (f == NULL)
+    perror (name);
+  return f;
+}
+
+// Write this rank's events, one per line, each preceded by a comma,
+// so that the fragments can simply be concatenated.
+void
+trace_write_fragment (int rank)
+{
+  char name[4096];
+  int n_threads = __atomic_load_n (&trace_n_threads, __ATOMIC_ACQUIRE);
+  snprintf (name, sizeof (name), "%s.%d", trace_file_name (), rank);
+  FILE *f = trace_open (name, "w");
+  if (f == NULL)
+    return;
+  fprintf (f, ",\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+	   "\"args\":{\"name\":\"rank %d\"}}", rank, rank);
+  fprintf (f, ",\n{\"name\":\"process_sort_index\",\"ph\":\"M\",\"pid\":%d,"
+	   "\"args\":{\"sort_index\":%d}}", rank, rank);
+  for (int t = 0; t < n_threads; t++)
+    {
+      struct trace_ring *ring =
+	__atomic_load_n (&trace_table[t], __ATOMIC_ACQUIRE);
+      if (ring == NULL)
+	continue;
+      unsigned long first = ring->n_events > TRACE_RING_EVENTS
+	? ring->n_events - TRACE_RING_EVENTS : 0;
+      fprintf (f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+	       "\"tid\":%d,\"args\":{\"name\":\"thread %d\","
+	       "\"dropped_events\":%lu}}", rank, t, t, first);
+      for (unsigned long i = first; i < ring->n_events; i++)
+	{
+	  const struct trace_event *e =
+	    &ring->event[i % TRACE_RING_EVENTS];
+	  double ts = (e->t0 + trace_offset - trace_base) * 1.0e6;
+	  double dur = (e->t1 - e->t0) * 1.0e6;
+	  fprintf (f, ",\n{\"name\":\"%s\",\"cat\":\"sort\",\"ph\":\"X\","
+		   "\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+		   "\"args\":{\"bytes\":%.0f", instr_name (e->slot),
+		   rank, t, ts, dur, e->bytes);
+	  if (e->slot >= INSTR_MERGE)
+	    fprintf (f, ",\"log2_size\":%d", e->slot - INSTR_MERGE);
+	  fputs ("}}", f);
+	}
+    }
+  fclose (f);
+}
+
+// Concatenate the fragments of ranks 0 .. RANKS-1 into the trace
+// file, and remove them.
+void
+trace_merge_fragments (int ranks)
+{
+  char name[4096], buf[65536];
+  const char *trace_name = trace_file_name ();
+  FILE *f = trace_open (trace_name, "w");
+  if (f == NULL)
+    return;
+  fputs ("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+	 "{\"name\":\"clock\",\"ph\":\"M\",\"pid\":0,"
+	 "\"args\":{\"source\":\"get_time\"}}", f);
+  for (int rank = 0; rank < ranks; rank++)
+    {
+      snprintf (name, sizeof (name), "%s.%d", trace_name, rank);
+      FILE *frag = trace_open (name, "r");
+      if (frag == NULL)
+	continue;
+      size_t n;
+      while ((n = fread (buf, 1, sizeof (buf), frag)) > 0)
+	fwrite (buf, 1, n, f);
+      fclose (frag);
+      unlink (name);
+    }
+  fputs ("\n]}\n", f);
+  fclose (f);
+  fprintf (stderr, "Trace written to %s\n", trace_name);
+}
@@ -0,0 +1,105 @@
+/* Chrome/Perfetto timeline traces of the merge sort drivers.
+   Copyright (C) 2026 Gary Funck <gary@intrepidtechnologyinc.com>
+
+ This program is free software; you can redistribute it and/or
+ modify it under the terms of the GNU General Public License as
+ published by the Free Software Foundation; either version 2 of
+ the License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public
+ License along with this program; if not, write to the Free
+ Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA  02110-1301, USA.
+
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+// Built with SORT_TRACE (make TRACE=1), every interval recorded
+// through the INSTR_* macros of instrument.h is also kept as an event
+// in a per-thread ring buffer of TRACE_RING_EVENTS entries; when
+// a ring fills up, the oldest events are overwritten.
+//
+// At exit, each rank writes its events to "<file>.<rank>", and rank 0
+// merges the fragments into "<file>", which can be loaded into
+// chrome://tracing or ui.perfetto.dev.  <file> is taken from the
+// SORT_TRACE_FILE environment variable, and defaults to
+// "sort_trace.json".  The fragments are exchanged through the file
+// system, which must therefore be shared by all ranks.
+//
+// Events are tagged with pid = rank and tid = the order in which the
+// threads of a rank first recorded an event.  Time stamps are shifted
+// by a per-rank clock offset relative to rank 0, and are relative to
+// the earliest event of the run.
+
+#ifdef SORT_TRACE
+
+#define TRACE_RING_EVENTS (1 << 16)
+
+extern double get_time (void);
+extern void trace_record (int slot, double t0, double t1, double bytes);
+extern double trace_start_time (void);
+extern void trace_set_clock (double offset, double base);
+extern void trace_write_fragment (int rank);
+extern void trace_merge_fragments (int ranks);
+
+#ifdef MPI_VERSION
+#define TRACE_SYNC_TAG    32001
+#define TRACE_SYNC_ROUNDS 8
+
+// Estimate each rank's clock offset to rank 0 with a few ping-pong
+// exchanges, keeping the estimate from the exchange with the smallest
+// round trip time (Cristian's algorithm).  Collective over COMM.
+static inline void
+trace_sync_clock_mpi (MPI_Comm comm)
+{
+  int rank, ranks;
+  double offset = 0.0, base, min_base;
+  MPI_Comm_rank (comm, &rank);
+  MPI_Comm_size (comm, &ranks);
+  for (int r = 1; r < ranks; r++)
+    {
+      if (!rank)
+	{
+	  for (int i = 0; i < TRACE_SYNC_ROUNDS; i++)
+	    {
+	      double t;
+	      MPI_Recv (&t, 1, MPI_DOUBLE, r, TRACE_SYNC_TAG, comm,
+			MPI_STATUS_IGNORE);
+	      t = get_time ();
+	      MPI_Send (&t, 1, MPI_DOUBLE, r, TRACE_SYNC_TAG, comm);
+	    }
+	}
+      else if (rank == r)
+	{
+	  double best_rtt = -1.0;
+	  for (int i = 0; i < TRACE_SYNC_ROUNDS; i++)
+	    {
+	      double t0 = get_time (), t_root;
+	      MPI_Send (&t0, 1, MPI_DOUBLE, 0, TRACE_SYNC_TAG, comm);
+	      MPI_Recv (&t_root, 1, MPI_DOUBLE, 0, TRACE_SYNC_TAG, comm,
+			MPI_STATUS_IGNORE);
+	      double t1 = get_time ();
+	      if (best_rtt < 0.0 || t1 - t0 < best_rtt)
+		{
+		  best_rtt = t1 - t0;
+		  offset = t_root - (t0 + t1) / 2.0;
+		}
+	    }
+	}
+    }
+  base = trace_start_time () + offset;
+  MPI_Allreduce (&base, &min_base, 1, MPI_DOUBLE, MPI_MIN, comm);
+  trace_set_clock (offset, min_base);
+}
+#endif /* MPI_VERSION */
+
+#endif /* SORT_TRACE */
+
+#endif /* TRACE_H */